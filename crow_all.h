@@ -9108,6 +9108,8 @@ namespace crow
             headers = std::move(r.headers);
             completed_ = r.completed_;
             file_info = std::move(r.file_info);
+            chunked_body = std::move(r.chunked_body);
+            manual_length_header = r.manual_length_header;
             return *this;
         }
 
@@ -9124,6 +9126,8 @@ namespace crow
             headers.clear();
             completed_ = false;
             file_info = static_file_info{};
+            chunked_body = nullptr;
+            manual_length_header = false;
         }
 
         /// Return a "Temporary Redirect" response.
@@ -9177,7 +9181,7 @@ namespace crow
             if (!completed_)
             {
                 completed_ = true;
-                if (skip_body)
+                if (skip_body && !is_chunked_type())
                 {
                     set_header("Content-Length", std::to_string(body.size()));
                     body = "";
@@ -9206,6 +9210,21 @@ namespace crow
         }
 
         /// Check whether the response has a static file defined.
+        /// Stream the body with chunked transfer encoding instead of sending `body`.
+        ///
+        /// The producer is called repeatedly to fill the next chunk (passed in empty) and returns false after the last one.
+        void set_chunked_body(std::function<bool(std::string&)> producer)
+        {
+            chunked_body = std::move(producer);
+            manual_length_header = true;
+            set_header("Transfer-Encoding", "chunked");
+        }
+
+        bool is_chunked_type() const
+        {
+            return static_cast<bool>(chunked_body);
+        }
+
         bool is_static_type()
         {
             return file_info.path.size();
@@ -9379,6 +9398,7 @@ namespace crow
         std::function<void()> complete_request_handler_;
         std::function<bool()> is_alive_helper_;
         static_file_info file_info;
+        std::function<bool(std::string&)> chunked_body;
     };
 } // namespace crow
 
@@ -10907,6 +10927,10 @@ namespace crow
             {
                 do_write_static();
             }
+            else if (res.is_chunked_type())
+            {
+                do_write_chunked();
+            }
             else
             {
                 do_write_general();
@@ -10958,6 +10982,51 @@ namespace crow
             parser_.clear();
         }
 
+        void do_write_chunked()
+        {
+            auto producer = std::move(res.chunked_body);
+            bool skip_body = res.skip_body;
+            error_code ec;
+            asio::write(adaptor_.socket(), buffers_, ec);
+            cancel_deadline_timer();
+
+            if (!skip_body)
+            {
+                static const std::string crlf = "\r\n";
+                static const std::string last_chunk = "0\r\n\r\n";
+                std::string chunk;
+                char size_line[20];
+                for (bool more = true; more && !ec;)
+                {
+                    chunk.clear();
+                    more = producer(chunk);
+                    if (chunk.empty())
+                        continue;
+                    int size_length = snprintf(size_line, sizeof(size_line), "%zx\r\n", chunk.size());
+                    std::vector<asio::const_buffer> buffers{
+                      asio::buffer(size_line, size_length), asio::buffer(chunk), asio::buffer(crlf)};
+                    asio::write(adaptor_.socket(), buffers, ec);
+                }
+                if (!ec)
+                    asio::write(adaptor_.socket(), asio::buffer(last_chunk), ec);
+            }
+            if (ec)
+            {
+                CROW_LOG_DEBUG << this << " chunked write stopped: " << ec;
+            }
+            if (close_connection_ || ec)
+            {
+                adaptor_.shutdown_readwrite();
+                adaptor_.close();
+                CROW_LOG_DEBUG << this << " from write (chunked)";
+            }
+
+            res.end();
+            res.clear();
+            buffers_.clear();
+            parser_.clear();
+        }
+
         void do_write_general()
         {
             if (res.body.length() < res_stream_threshold_)
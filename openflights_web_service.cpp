@@ -1,3 +1,4 @@
+#define CROW_ENABLE_COMPRESSION  // crow::compression, used to inflate gzip uploads
 #include "crow_all.h"
 #include <fstream>
 #include <sstream>
@@ -5,9 +6,26 @@
 #include <map>
 #include <set>
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <deque>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <shared_mutex>
+#include <thread>
+#include <tuple>
 
 // Safe conversion helpers
 float safe_stof(const std::string &s, float def = 0.0f) {
@@ -43,6 +61,22 @@ std::string urlDecode(const std::string& s) {
     return out;
 }
 
+// Percent-encode a query parameter value
+std::string urlEncode(const std::string& s) {
+    static const char* hex = "0123456789ABCDEF";
+    std::string out;
+    for (unsigned char c : s) {
+        if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            out.push_back(c);
+        } else {
+            out.push_back('%');
+            out.push_back(hex[c >> 4]);
+            out.push_back(hex[c & 15]);
+        }
+    }
+    return out;
+}
+
 // Parse x-www-form-urlencoded body into a map
 std::unordered_map<std::string, std::string> parseFormBody(const std::string& body) {
     std::unordered_map<std::string, std::string> result;
@@ -62,33 +96,152 @@ std::unordered_map<std::string, std::string> parseFormBody(const std::string& bo
     return result;
 }
 
-// Entity structures
-struct Airport {
+// Interns the distinct values of a low-cardinality column. Records keep
+// the 16-bit code; code 0 is always the empty string, so value-initialized
+// records read back as blank fields. The last code is never handed out:
+// it marks a value that didn't fit.
+class StringDictionary {
+public:
+    static constexpr uint16_t NONE = UINT16_MAX;
+
+    StringDictionary() {
+        uint16_t empty;
+        intern("", empty);
+    }
+
+    // False, leaving the dictionary unchanged, once every code is taken
+    bool intern(const std::string& value, uint16_t& code) {
+        auto it = codes_.find(value);
+        if (it != codes_.end()) {
+            code = it->second;
+            return true;
+        }
+        if (values_.size() >= NONE) return false;
+        code = static_cast<uint16_t>(values_.size());
+        values_.push_back(value);
+        codes_.emplace(value, code);
+        return true;
+    }
+
+    // Look up a value without adding it
+    bool find(const std::string& value, uint16_t& code) const {
+        auto it = codes_.find(value);
+        if (it == codes_.end()) return false;
+        code = it->second;
+        return true;
+    }
+
+    const std::string& lookup(uint16_t code) const { return values_[code]; }
+    size_t size() const { return values_.size(); }
+
+    // Codes still free to hand out
+    size_t room() const { return NONE - values_.size(); }
+
+private:
+    std::vector<std::string> values_;
+    std::unordered_map<std::string, uint16_t> codes_;
+};
+
+// The dictionaries behind the coded record fields. Country names are
+// shared by airports and airlines.
+struct Dictionaries {
+    StringDictionary countries;
+    StringDictionary dst;
+    StringDictionary timezones;
+    StringDictionary airport_types;
+    StringDictionary sources;
+    StringDictionary active;
+
+    // For each dictionary of another set, the code of the same string here
+    struct Remap {
+        std::vector<uint16_t> countries, dst, timezones, airport_types, sources, active;
+    };
+
+    // Intern every value of `from` and return how its codes translate.
+    // Values that don't fit translate to NONE.
+    Remap absorb(const Dictionaries& from) {
+        auto map = [](StringDictionary& into, const StringDictionary& src) {
+            std::vector<uint16_t> codes(src.size());
+            for (size_t i = 0; i < src.size(); i++) {
+                if (!into.intern(src.lookup(static_cast<uint16_t>(i)), codes[i]))
+                    codes[i] = StringDictionary::NONE;
+            }
+            return codes;
+        };
+        Remap remap;
+        remap.countries     = map(countries, from.countries);
+        remap.dst           = map(dst, from.dst);
+        remap.timezones     = map(timezones, from.timezones);
+        remap.airport_types = map(airport_types, from.airport_types);
+        remap.sources       = map(sources, from.sources);
+        remap.active        = map(active, from.active);
+        return remap;
+    }
+
+    // Whether absorbing all of `sources` fits every dictionary; otherwise
+    // names the column that overflows
+    bool canAbsorb(const std::vector<const Dictionaries*>& sources, std::string& column) const {
+        auto fits = [&](StringDictionary Dictionaries::*member) {
+            const StringDictionary& into = this->*member;
+            std::unordered_set<std::string> added;
+            for (const Dictionaries* from : sources) {
+                const StringDictionary& src = from->*member;
+                uint16_t code;
+                for (size_t i = 0; i < src.size(); i++) {
+                    const std::string& value = src.lookup(static_cast<uint16_t>(i));
+                    if (!into.find(value, code)) added.insert(value);
+                }
+            }
+            return added.size() <= into.room();
+        };
+        const std::pair<StringDictionary Dictionaries::*, const char*> members[] = {
+            {&Dictionaries::countries, "country"},   {&Dictionaries::dst, "DST"},
+            {&Dictionaries::timezones, "timezone"},  {&Dictionaries::airport_types, "type"},
+            {&Dictionaries::sources, "source"},      {&Dictionaries::active, "active"}};
+        for (const auto& [member, name] : members) {
+            if (!fits(member)) {
+                column = name;
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Reason a row is rejected when one of its values doesn't fit a dictionary
+std::string tooManyValues(const std::string& column) {
+    return "too many distinct " + column + " values";
+}
+
+// Entity structures. Airports and airlines are stored by value in
+// contiguous tables, so records are aligned to cache lines. Fields typed
+// uint16_t are codes into the owning Dictionaries.
+struct alignas(64) Airport {
     int id;
     std::string name;
     std::string city;
-    std::string country;
+    uint16_t country;
     std::string iata;
     std::string icao;
     double latitude;
     double longitude;
     int altitude;
     float timezone;
-    std::string dst;
-    std::string tz_database;
-    std::string type;
-    std::string source;
+    uint16_t dst;
+    uint16_t tz_database;
+    uint16_t type;
+    uint16_t source;
 };
 
-struct Airline {
+struct alignas(64) Airline {
     int id;
     std::string name;
     std::string alias;
     std::string iata;
     std::string icao;
     std::string callsign;
-    std::string country;
-    std::string active;
+    uint16_t country;
+    uint16_t active;
 };
 
 struct Route {
@@ -101,21 +254,825 @@ struct Route {
     std::string codeshare;
     int stops;
     std::string equipment;
+    uint16_t source_country = 0;    // joined from the airports by addRoute
+    uint16_t dest_country = 0;      // and rejoinRouteCountries
+};
+
+// Contiguous record store addressed by a dense internal slot. OpenFlights
+// IDs are translated through a flat slot_by_id table; only IDs outside its
+// range (such as the -1 "Unknown" airline) go through a hash map. Deleted
+// records are tombstoned so slots held by other indexes stay valid.
+template <typename T>
+class EntityTable {
+public:
+    static constexpr int32_t NO_SLOT = -1;
+    static constexpr int MAX_FLAT_ID = 1 << 20;
+
+    int32_t slotOf(int id) const {
+        if (id >= 0 && id < MAX_FLAT_ID)
+            return id < (int)slot_by_id_.size() ? slot_by_id_[id] : NO_SLOT;
+        auto it = overflow_ids_.find(id);
+        return it == overflow_ids_.end() ? NO_SLOT : it->second;
+    }
+
+    const T* find(int id) const {
+        int32_t slot = slotOf(id);
+        return slot == NO_SLOT ? nullptr : &records_[slot];
+    }
+
+    const T& at(int32_t slot) const { return records_[slot]; }
+    T& at(int32_t slot) { return records_[slot]; }
+    bool isLive(int32_t slot) const { return live_[slot]; }
+
+    size_t size() const { return live_count_; }    // live records
+    size_t slots() const { return records_.size(); }
+
+    // Insert a record, or replace the one with the same ID in place
+    int32_t upsert(T record) {
+        int32_t slot = slotOf(record.id);
+        if (slot != NO_SLOT) {
+            records_[slot] = std::move(record);
+            return slot;
+        }
+        slot = static_cast<int32_t>(records_.size());
+        bindId(record.id, slot);
+        records_.push_back(std::move(record));
+        live_.push_back(1);
+        live_count_++;
+        return slot;
+    }
+
+    void erase(int32_t slot) {
+        bindId(records_[slot].id, NO_SLOT);
+        live_[slot] = 0;
+        live_count_--;
+    }
+
+    // Visit live records in storage order
+    template <typename F>
+    void forEach(F visit) const {
+        for (size_t i = 0; i < records_.size(); i++)
+            if (live_[i]) visit(static_cast<int32_t>(i), records_[i]);
+    }
+
+private:
+    void bindId(int id, int32_t slot) {
+        if (id >= 0 && id < MAX_FLAT_ID) {
+            if (id >= (int)slot_by_id_.size()) slot_by_id_.resize(id + 1, NO_SLOT);
+            slot_by_id_[id] = slot;
+        } else if (slot == NO_SLOT) {
+            overflow_ids_.erase(id);
+        } else {
+            overflow_ids_[id] = slot;
+        }
+    }
+
+    std::vector<T> records_;
+    std::vector<uint8_t> live_;
+    std::vector<int32_t> slot_by_id_;
+    std::unordered_map<int, int32_t> overflow_ids_;
+    size_t live_count_ = 0;
+};
+
+// Inverted index from character trigrams to table slots, for fuzzy name
+// search. Text is lower-cased and split into words, each padded with a
+// space on both sides so word starts and ends count as trigrams too.
+// Posting lists are kept sorted by slot.
+class TrigramIndex {
+public:
+    struct Match {
+        int32_t slot;
+        float score;    // share of the query's trigrams the record has
+    };
+
+    // Index a slot's text, replacing whatever it had before
+    void update(int32_t slot, const std::string& text) {
+        remove(slot);
+        if (slot >= (int32_t)grams_by_slot_.size()) grams_by_slot_.resize(slot + 1);
+        grams_by_slot_[slot] = trigrams(text);
+        for (uint32_t gram : grams_by_slot_[slot]) {
+            auto& list = postings_[gram];
+            list.insert(std::lower_bound(list.begin(), list.end(), slot), slot);
+        }
+    }
+
+    void remove(int32_t slot) {
+        if (slot >= (int32_t)grams_by_slot_.size()) return;
+        for (uint32_t gram : grams_by_slot_[slot]) {
+            auto it = postings_.find(gram);
+            auto& list = it->second;
+            list.erase(std::lower_bound(list.begin(), list.end(), slot));
+            if (list.empty()) postings_.erase(it);
+        }
+        grams_by_slot_[slot].clear();
+    }
+
+    // Best matches first: records sharing the most query trigrams, shorter
+    // text breaking ties. Records with under half of them are dropped,
+    // which still lets a query through with a typo or two.
+    std::vector<Match> search(const std::string& query, size_t limit) const {
+        std::vector<uint32_t> grams = trigrams(query);
+        std::vector<Match> matches;
+        if (grams.empty()) return matches;
+
+        thread_local std::vector<uint16_t> hits;
+        thread_local std::vector<int32_t> touched;
+        if (hits.size() < grams_by_slot_.size()) hits.resize(grams_by_slot_.size(), 0);
+        touched.clear();
+        for (uint32_t gram : grams) {
+            auto it = postings_.find(gram);
+            if (it == postings_.end()) continue;
+            for (int32_t slot : it->second)
+                if (hits[slot]++ == 0) touched.push_back(slot);
+        }
+
+        size_t min_hits = (grams.size() + 1) / 2;
+        for (int32_t slot : touched) {
+            if (hits[slot] >= min_hits)
+                matches.push_back({slot, (float)hits[slot] / grams.size()});
+        }
+        auto better = [&](const Match& a, const Match& b) {
+            if (hits[a.slot] != hits[b.slot]) return hits[a.slot] > hits[b.slot];
+            size_t len_a = grams_by_slot_[a.slot].size(), len_b = grams_by_slot_[b.slot].size();
+            return len_a != len_b ? len_a < len_b : a.slot < b.slot;
+        };
+        if (matches.size() > limit) {
+            std::partial_sort(matches.begin(), matches.begin() + limit, matches.end(), better);
+            matches.resize(limit);
+        } else {
+            std::sort(matches.begin(), matches.end(), better);
+        }
+        for (int32_t slot : touched) hits[slot] = 0;
+        return matches;
+    }
+
+private:
+    // Distinct trigrams of a text, packed three bytes to an integer
+    static std::vector<uint32_t> trigrams(const std::string& text) {
+        std::vector<uint32_t> grams;
+        std::string word = " ";
+        auto flush = [&] {
+            if (word.size() > 1) {
+                word += ' ';
+                for (size_t i = 0; i + 2 < word.size(); i++)
+                    grams.push_back((uint8_t)word[i] << 16 | (uint8_t)word[i + 1] << 8 | (uint8_t)word[i + 2]);
+            }
+            word = " ";
+        };
+        for (unsigned char c : text) {
+            if (std::isalnum(c) || c >= 0x80) word += (char)std::tolower(c);
+            else flush();
+        }
+        flush();
+        std::sort(grams.begin(), grams.end());
+        grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+        return grams;
+    }
+
+    std::unordered_map<uint32_t, std::vector<int32_t>> postings_;
+    std::vector<std::vector<uint32_t>> grams_by_slot_;
+};
+
+// Move a record's codes from one dictionary set to another; fails when
+// a value didn't fit the target dictionaries
+bool recode(Airport& airport, const Dictionaries::Remap& remap, std::string& reason) {
+    airport.country     = remap.countries[airport.country];
+    airport.dst         = remap.dst[airport.dst];
+    airport.tz_database = remap.timezones[airport.tz_database];
+    airport.type        = remap.airport_types[airport.type];
+    airport.source      = remap.sources[airport.source];
+    const std::pair<uint16_t, const char*> fields[] = {
+        {airport.country, "country"}, {airport.dst, "DST"}, {airport.tz_database, "timezone"},
+        {airport.type, "type"}, {airport.source, "source"}};
+    for (const auto& [code, column] : fields) {
+        if (code == StringDictionary::NONE) {
+            reason = tooManyValues(column);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool recode(Airline& airline, const Dictionaries::Remap& remap, std::string& reason) {
+    airline.country = remap.countries[airline.country];
+    airline.active  = remap.active[airline.active];
+    if (airline.country == StringDictionary::NONE) reason = tooManyValues("country");
+    else if (airline.active == StringDictionary::NONE) reason = tooManyValues("active");
+    return reason.empty();
+}
+
+bool recode(Route&, const Dictionaries::Remap&, std::string&) { return true; }
+
+// The text fuzzy name search matches against
+std::string searchText(const Airport& airport) {
+    return airport.name + " " + airport.city;
+}
+
+std::string searchText(const Airline& airline) {
+    return airline.alias == "\\N" ? airline.name : airline.name + " " + airline.alias;
+}
+
+// Counting Bloom filter whose k probes for a key all land in one 64-byte
+// block, so a negative answer costs a single cache miss. Counters are 4
+// bits and stick once they saturate, which keeps removals safe.
+class BlockedCountingBloom {
+public:
+    explicit BlockedCountingBloom(size_t expected_keys = 0) { reset(expected_keys); }
+
+    // Empty the filter, sized for about 16 counters per key
+    void reset(size_t expected_keys) {
+        size_t blocks = 1;
+        while (blocks * COUNTERS_PER_BLOCK < expected_keys * 16) blocks *= 2;
+        words_.assign(blocks * WORDS_PER_BLOCK, 0);
+        capacity_ = blocks * COUNTERS_PER_BLOCK / 16;
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    void add(uint64_t hash) {
+        forEachCounter(hash, [](uint64_t& word, unsigned shift) {
+            uint64_t c = (word >> shift) & 0xF;
+            if (c < 0xF) word += uint64_t(1) << shift;
+        });
+    }
+
+    void remove(uint64_t hash) {
+        forEachCounter(hash, [](uint64_t& word, unsigned shift) {
+            uint64_t c = (word >> shift) & 0xF;
+            if (c > 0 && c < 0xF) word -= uint64_t(1) << shift;
+        });
+    }
+
+    bool mayContain(uint64_t hash) const {
+        const uint64_t* block = &words_[blockOf(hash)];
+        for (unsigned i = 0; i < PROBES; i++) {
+            unsigned counter = (hash >> (i * 7)) & (COUNTERS_PER_BLOCK - 1);
+            if (((block[counter / 16] >> (counter % 16 * 4)) & 0xF) == 0) return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr unsigned WORDS_PER_BLOCK = 8;              // 64 bytes
+    static constexpr unsigned COUNTERS_PER_BLOCK = WORDS_PER_BLOCK * 16;
+    static constexpr unsigned PROBES = 4;
+
+    size_t blockOf(uint64_t hash) const {
+        return (hash >> 32) % (words_.size() / WORDS_PER_BLOCK) * WORDS_PER_BLOCK;
+    }
+
+    template <typename F>
+    void forEachCounter(uint64_t hash, F apply) {
+        uint64_t* block = &words_[blockOf(hash)];
+        for (unsigned i = 0; i < PROBES; i++) {
+            unsigned counter = (hash >> (i * 7)) & (COUNTERS_PER_BLOCK - 1);
+            apply(block[counter / 16], counter % 16 * 4);
+        }
+    }
+
+    std::vector<uint64_t> words_;
+    size_t capacity_ = 0;
+};
+
+// Multiset of (airline, source, destination) triples for existence
+// probes. Codes of up to three letters or digits pack base-37 into 16 bits
+// each, and every route is counted under its airline and under a wildcard
+// airline, so "any airline" is answered by the same probe. The counts live
+// in an open-addressing table; routes with codes that don't pack are kept
+// in a small string-keyed map instead.
+class RouteExistenceIndex {
+public:
+    void add(const Route& route) {
+        forEachKey(route.airline_code, route.source_airport, route.dest_airport,
+                   [&](uint64_t key) { addKey(key); },
+                   [&](const std::string& key) { overflow_[key]++; });
+    }
+
+    void remove(const Route& route) {
+        forEachKey(route.airline_code, route.source_airport, route.dest_airport,
+                   [&](uint64_t key) { removeKey(key); },
+                   [&](const std::string& key) {
+                       auto it = overflow_.find(key);
+                       if (it != overflow_.end() && --it->second == 0) overflow_.erase(it);
+                   });
+    }
+
+    // Number of routes matching; an empty airline matches any airline
+    uint32_t count(const std::string& airline, const std::string& source, const std::string& dest) const {
+        uint64_t key;
+        if (!pack(airline, source, dest, key)) {
+            auto it = overflow_.find(overflowKey(airline, source, dest));
+            return it == overflow_.end() ? 0 : it->second;
+        }
+        uint64_t hash = mix(key);
+        if (keys_.empty() || !bloom_.mayContain(hash)) return 0;
+        for (size_t i = hash & (keys_.size() - 1);; i = (i + 1) & (keys_.size() - 1)) {
+            if (keys_[i] == EMPTY) return 0;
+            if (keys_[i] == key) return counts_[i];
+        }
+    }
+
+    size_t size() const { return used_; }
+
+private:
+    static constexpr uint64_t EMPTY = ~uint64_t(0);
+    static constexpr uint64_t WILDCARD = uint64_t(1) << 48;
+
+    static bool packCode(const std::string& code, uint64_t& out) {
+        if (code.empty() || code.size() > 3) return false;
+        out = 0;
+        for (size_t i = 0; i < 3; i++) {
+            uint64_t digit = 0;
+            if (i < code.size()) {
+                char c = code[i];
+                if (c >= '0' && c <= '9') digit = 1 + (c - '0');
+                else if (c >= 'A' && c <= 'Z') digit = 11 + (c - 'A');
+                else return false;
+            }
+            out = out * 37 + digit;
+        }
+        return true;
+    }
+
+    // An empty airline packs to the wildcard key
+    static bool pack(const std::string& airline, const std::string& source, const std::string& dest, uint64_t& key) {
+        uint64_t a = 0, s, d;
+        if (!packCode(source, s) || !packCode(dest, d)) return false;
+        if (airline.empty()) {
+            key = WILDCARD | s << 16 | d;
+            return true;
+        }
+        if (!packCode(airline, a)) return false;
+        key = a << 32 | s << 16 | d;
+        return true;
+    }
+
+    // A route is counted under its airline and under the wildcard
+    template <typename Packed, typename Overflow>
+    static void forEachKey(const std::string& airline, const std::string& source, const std::string& dest,
+                           Packed packed, Overflow overflow) {
+        auto visit = [&](const std::string& a) {
+            uint64_t key;
+            if (pack(a, source, dest, key)) packed(key);
+            else overflow(overflowKey(a, source, dest));
+        };
+        if (!airline.empty()) visit(airline);
+        visit("");
+    }
+
+    static std::string overflowKey(const std::string& airline, const std::string& source, const std::string& dest) {
+        return airline + "|" + source + "|" + dest;
+    }
+
+    static uint64_t mix(uint64_t x) {       // splitmix64 finalizer
+        x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    void addKey(uint64_t key) {
+        if ((used_ + 1) * 2 > keys_.size()) grow();
+        uint64_t hash = mix(key);
+        size_t i = hash & (keys_.size() - 1);
+        while (keys_[i] != EMPTY && keys_[i] != key) i = (i + 1) & (keys_.size() - 1);
+        if (keys_[i] == EMPTY) {
+            keys_[i] = key;
+            used_++;
+            if (used_ > bloom_.capacity()) rebuildBloom();
+            else bloom_.add(hash);
+        }
+        counts_[i]++;
+    }
+
+    void removeKey(uint64_t key) {
+        if (keys_.empty()) return;
+        size_t mask = keys_.size() - 1;
+        size_t i = mix(key) & mask;
+        while (keys_[i] != key) {
+            if (keys_[i] == EMPTY) return;
+            i = (i + 1) & mask;
+        }
+        if (--counts_[i] > 0) return;
+        bloom_.remove(mix(key));
+        used_--;
+
+        // Backward-shift deletion keeps probe chains unbroken without tombstones
+        for (size_t j = (i + 1) & mask; keys_[j] != EMPTY; j = (j + 1) & mask) {
+            size_t home = mix(keys_[j]) & mask;
+            if (((j - home) & mask) >= ((j - i) & mask)) {
+                keys_[i] = keys_[j];
+                counts_[i] = counts_[j];
+                i = j;
+            }
+        }
+        keys_[i] = EMPTY;
+        counts_[i] = 0;
+    }
+
+    void grow() {
+        std::vector<uint64_t> old_keys = std::move(keys_);
+        std::vector<uint32_t> old_counts = std::move(counts_);
+        size_t size = std::max<size_t>(1024, old_keys.size() * 2);
+        keys_.assign(size, EMPTY);
+        counts_.assign(size, 0);
+        for (size_t i = 0; i < old_keys.size(); i++) {
+            if (old_keys[i] == EMPTY) continue;
+            size_t j = mix(old_keys[i]) & (size - 1);
+            while (keys_[j] != EMPTY) j = (j + 1) & (size - 1);
+            keys_[j] = old_keys[i];
+            counts_[j] = old_counts[i];
+        }
+    }
+
+    void rebuildBloom() {
+        bloom_.reset(used_ * 2);
+        for (uint64_t key : keys_)
+            if (key != EMPTY) bloom_.add(mix(key));
+    }
+
+    std::vector<uint64_t> keys_;
+    std::vector<uint32_t> counts_;
+    size_t used_ = 0;
+    BlockedCountingBloom bloom_;
+    std::unordered_map<std::string, uint32_t> overflow_;
+};
+
+// Upper-cased copy; codes and callsigns are matched case-insensitively
+std::string upperCase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), ::toupper);
+    return text;
+}
+
+// Code indexes map a code to a table slot. When codes collide the last
+// row seen wins, as in the loaders; empty and "\N" codes aren't indexed.
+using CodeIndex = std::unordered_map<std::string, int32_t>;
+
+void bindCode(CodeIndex& index, const std::string& code, int32_t slot) {
+    if (!code.empty() && code != "\\N") index[code] = slot;
+}
+
+// Drop a code's entry if it still belongs to the given slot
+void unbindCode(CodeIndex& index, const std::string& code, int32_t slot) {
+    auto it = index.find(code);
+    if (it != index.end() && it->second == slot) index.erase(it);
+}
+
+// Route counts and distinct airlines between every pair of countries, as
+// dense arrays over country dictionary codes; code 0 collects routes with
+// an unknown airport. A route insert or delete touches one cell and one
+// airline tally.
+class CountryMatrix {
+public:
+    void add(const Route& route) { update(route, 1); }
+    void remove(const Route& route) { update(route, -1); }
+
+    // Codes below size() may have nonzero cells
+    size_t size() const { return n_; }
+
+    uint32_t routes(uint16_t source, uint16_t dest) const {
+        return source < n_ && dest < n_ ? routes_[source * n_ + dest] : 0;
+    }
+
+    uint32_t airlines(uint16_t source, uint16_t dest) const {
+        return source < n_ && dest < n_ ? airlines_[source * n_ + dest] : 0;
+    }
+
+private:
+    void grow(size_t n) {
+        if (n <= n_) return;
+        n = std::max(n, n_ + n_ / 2);
+        std::vector<uint32_t> routes(n * n), airlines(n * n);
+        for (size_t s = 0; s < n_; s++) {
+            std::copy_n(routes_.begin() + s * n_, n_, routes.begin() + s * n);
+            std::copy_n(airlines_.begin() + s * n_, n_, airlines.begin() + s * n);
+        }
+        routes_.swap(routes);
+        airlines_.swap(airlines);
+        n_ = n;
+    }
+
+    void update(const Route& route, int delta) {
+        uint16_t source = route.source_country, dest = route.dest_country;
+        grow(std::max(source, dest) + 1);
+        size_t cell = source * n_ + dest;
+        routes_[cell] += delta;
+
+        auto id = airline_ids_.try_emplace(route.airline_code, (uint32_t)airline_ids_.size()).first->second;
+        uint64_t key = (uint64_t)source << 48 | (uint64_t)dest << 32 | id;
+        if (delta > 0) {
+            if (carriers_[key]++ == 0) airlines_[cell]++;
+        } else if (auto it = carriers_.find(key); it != carriers_.end() && --it->second == 0) {
+            carriers_.erase(it);
+            airlines_[cell]--;
+        }
+    }
+
+    size_t n_ = 0;
+    std::vector<uint32_t> routes_;
+    std::vector<uint32_t> airlines_;
+    std::unordered_map<std::string, uint32_t> airline_ids_;
+    std::unordered_map<uint64_t, uint32_t> carriers_;   // routes per cell and airline
+};
+
+// Items ranked by an integer score. Each score owns a bucket of items and
+// the nonempty scores are kept in order, so moving an item is a swap-remove
+// and an append, and the top K are read off the highest buckets. The caller
+// keeps each item's index within its bucket, reached through pos(item).
+class BucketRank {
+public:
+    template <typename Pos>
+    void insert(uint32_t item, uint32_t score, Pos pos) {
+        if (buckets_.size() <= score) buckets_.resize(score + 1);
+        if (buckets_[score].empty()) scores_.insert(score);
+        pos(item) = (uint32_t)buckets_[score].size();
+        buckets_[score].push_back(item);
+    }
+
+    template <typename Pos>
+    void erase(uint32_t item, uint32_t score, Pos pos) {
+        auto& bucket = buckets_[score];
+        uint32_t at = pos(item);
+        bucket[at] = bucket.back();
+        pos(bucket[at]) = at;
+        bucket.pop_back();
+        if (bucket.empty()) scores_.erase(score);
+    }
+
+    // Visit up to k items with a nonzero score, highest first; ties come
+    // in no particular order
+    template <typename F>
+    void top(size_t k, F visit) const {
+        for (auto it = scores_.rbegin(); it != scores_.rend() && *it > 0; ++it) {
+            for (uint32_t item : buckets_[*it]) {
+                if (k == 0) return;
+                visit(item, *it);
+                k--;
+            }
+        }
+    }
+
+private:
+    std::vector<std::vector<uint32_t>> buckets_;
+    std::set<uint32_t> scores_;
+};
+
+// Per-airport route degree, distinct destinations and distinct airlines,
+// kept current by addRoute and eraseRoutes. Airports are keyed by the codes
+// routes use and ranked on each counter both globally and within the
+// country the routes were joined to.
+class HubCounters {
+public:
+    enum Metric { ROUTES, DESTINATIONS, AIRLINES, METRIC_COUNT };
+    static constexpr const char* NAMES[METRIC_COUNT] = {"routes", "destinations", "airlines"};
+
+    struct Hub {
+        std::string iata;
+        uint16_t country = 0;
+        uint32_t routes_out = 0;
+        uint32_t routes_in = 0;
+        uint32_t score[METRIC_COUNT] = {};
+        uint32_t pos[2][METRIC_COUNT] = {};     // bucket index, global and in country
+    };
+
+    void add(const Route& route) { update(route, 1); }
+    void remove(const Route& route) { update(route, -1); }
+
+    // Visit the top k hubs on a metric, in one country or everywhere
+    template <typename F>
+    void top(Metric metric, std::optional<uint16_t> country, size_t k, F visit) const {
+        const BucketRank* rank = &global_[metric];
+        if (country) {
+            auto it = by_country_.find(*country);
+            if (it == by_country_.end()) return;
+            rank = &it->second[metric];
+        }
+        rank->top(k, [&](uint32_t id, uint32_t) { visit(hubs_[id]); });
+    }
+
+private:
+    auto posIn(int scope, Metric metric) {
+        return [this, scope, metric](uint32_t id) -> uint32_t& { return hubs_[id].pos[scope][metric]; };
+    }
+
+    // The hub for an airport code, moved to the country the route gives it
+    uint32_t hubOf(const std::string& iata, uint16_t country) {
+        auto [it, inserted] = ids_.try_emplace(iata, (uint32_t)hubs_.size());
+        uint32_t id = it->second;
+        if (inserted) {
+            hubs_.push_back(Hub{iata, country});
+            for (int m = 0; m < METRIC_COUNT; m++) {
+                global_[m].insert(id, 0, posIn(0, (Metric)m));
+                by_country_[country][m].insert(id, 0, posIn(1, (Metric)m));
+            }
+        } else if (hubs_[id].country != country) {
+            for (int m = 0; m < METRIC_COUNT; m++) {
+                uint32_t score = hubs_[id].score[m];
+                by_country_[hubs_[id].country][m].erase(id, score, posIn(1, (Metric)m));
+                by_country_[country][m].insert(id, score, posIn(1, (Metric)m));
+            }
+            hubs_[id].country = country;
+        }
+        return id;
+    }
+
+    void bump(uint32_t id, Metric metric, int delta) {
+        Hub& hub = hubs_[id];
+        uint32_t score = hub.score[metric];
+        BucketRank& local = by_country_[hub.country][metric];
+        global_[metric].erase(id, score, posIn(0, metric));
+        local.erase(id, score, posIn(1, metric));
+        hub.score[metric] = score + delta;
+        global_[metric].insert(id, score + delta, posIn(0, metric));
+        local.insert(id, score + delta, posIn(1, metric));
+    }
+
+    // Count a pair's routes; true when the first one arrives or the last leaves
+    static bool tally(std::unordered_map<uint64_t, uint32_t>& tallies, uint64_t key, int delta) {
+        if (delta > 0) return tallies[key]++ == 0;
+        auto it = tallies.find(key);
+        if (it == tallies.end() || --it->second) return false;
+        tallies.erase(it);
+        return true;
+    }
+
+    void update(const Route& route, int delta) {
+        uint32_t source = hubOf(route.source_airport, route.source_country);
+        uint32_t dest = hubOf(route.dest_airport, route.dest_country);
+        hubs_[source].routes_out += delta;
+        hubs_[dest].routes_in += delta;
+        bump(source, ROUTES, delta);
+        bump(dest, ROUTES, delta);
+        if (tally(neighbors_, (uint64_t)source << 32 | dest, delta)) bump(source, DESTINATIONS, delta);
+
+        uint32_t airline = airline_ids_.try_emplace(route.airline_code, (uint32_t)airline_ids_.size()).first->second;
+        if (tally(carriers_, (uint64_t)source << 32 | airline, delta)) bump(source, AIRLINES, delta);
+        if (dest != source && tally(carriers_, (uint64_t)dest << 32 | airline, delta)) bump(dest, AIRLINES, delta);
+    }
+
+    std::vector<Hub> hubs_;
+    std::unordered_map<std::string, uint32_t> ids_;
+    std::unordered_map<std::string, uint32_t> airline_ids_;
+    std::unordered_map<uint64_t, uint32_t> neighbors_;     // routes per source and destination
+    std::unordered_map<uint64_t, uint32_t> carriers_;      // routes per airport and airline
+    BucketRank global_[METRIC_COUNT];
+    std::unordered_map<uint16_t, std::array<BucketRank, METRIC_COUNT>> by_country_;
+};
+
+// Union-find with union by size. Finds don't compress paths, so readers
+// can share it; trees stay O(log n) deep.
+class DisjointSets {
+public:
+    uint32_t add() {
+        uint32_t v = (uint32_t)parent_.size();
+        parent_.push_back(v);
+        size_.push_back(1);
+        sets_++;
+        return v;
+    }
+
+    uint32_t find(uint32_t v) const {
+        while (parent_[v] != v) v = parent_[v];
+        return v;
+    }
+
+    bool unite(uint32_t a, uint32_t b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) return false;
+        if (size_[a] < size_[b]) std::swap(a, b);
+        parent_[b] = a;
+        size_[a] += size_[b];
+        sets_--;
+        return true;
+    }
+
+    uint32_t sizeOf(uint32_t v) const { return size_[find(v)]; }
+    size_t sets() const { return sets_; }
+
+private:
+    std::vector<uint32_t> parent_;
+    std::vector<uint32_t> size_;
+    size_t sets_ = 0;
 };
 
-// Global data containers
-std::unordered_map<std::string, std::shared_ptr<Airport>> airports_by_iata;
-std::unordered_map<int, std::shared_ptr<Airport>> airports_by_id;
-std::unordered_map<std::string, std::shared_ptr<Airline>> airlines_by_iata;
-std::unordered_map<int, std::shared_ptr<Airline>> airlines_by_id;
-std::vector<std::shared_ptr<Route>> routes;
+// Weakly connected components over the airport codes routes use. A route
+// insert is one union. A delete can split a component, which union-find
+// can't undo, so eraseRoutes marks the sets stale; inserts skip the union
+// until then, and the first reader rebuilds the sets from the routes and
+// goes back to incremental unions. Readers share the session lock, so the
+// rebuild is serialized by a mutex of its own.
+class WeakComponents {
+public:
+    WeakComponents() = default;
+    WeakComponents(const WeakComponents& other) { *this = other; }
+
+    WeakComponents& operator=(const WeakComponents& other) {
+        if (this == &other) return *this;
+        std::lock_guard<std::mutex> lock(other.rebuild_mutex_);
+        sets_ = other.sets_;
+        ids_ = other.ids_;
+        stale_.store(other.stale_.load());
+        return *this;
+    }
+
+    void add(const Route& route) {
+        if (stale_.load(std::memory_order_relaxed)) return;
+        sets_.unite(idOf(route.source_airport), idOf(route.dest_airport));
+    }
+
+    void invalidate() { stale_.store(true); }
+
+    // Rebuild after deletes; call before reading under a shared lock
+    void refresh(const std::vector<Route>& routes) const {
+        if (!stale_.load(std::memory_order_acquire)) return;
+        std::lock_guard<std::mutex> lock(rebuild_mutex_);
+        if (!stale_.load(std::memory_order_relaxed)) return;
+        auto* self = const_cast<WeakComponents*>(this);
+        self->sets_ = DisjointSets();
+        self->ids_.clear();
+        for (const auto& route : routes) self->sets_.unite(self->idOf(route.source_airport), self->idOf(route.dest_airport));
+        stale_.store(false, std::memory_order_release);
+    }
+
+    // Component root of an airport code, if any route uses it
+    std::optional<uint32_t> find(const std::string& iata) const {
+        auto it = ids_.find(iata);
+        if (it == ids_.end()) return std::nullopt;
+        return sets_.find(it->second);
+    }
+
+    uint32_t sizeOf(uint32_t root) const { return sets_.sizeOf(root); }
+    size_t components() const { return sets_.sets(); }
+
+private:
+    uint32_t idOf(const std::string& iata) {
+        auto [it, inserted] = ids_.try_emplace(iata, 0);
+        if (inserted) it->second = sets_.add();
+        return it->second;
+    }
+
+    DisjointSets sets_;
+    std::unordered_map<std::string, uint32_t> ids_;
+    mutable std::atomic<bool> stale_{false};
+    mutable std::mutex rebuild_mutex_;
+};
+
+// One complete copy of the data: airport and airline tables with their
+// code and name indexes (which map to table slots), the route list, and
+// the dictionaries the coded fields refer to
+struct Dataset {
+    Dictionaries dicts;
+    EntityTable<Airport> airports;
+    EntityTable<Airline> airlines;
+    CodeIndex airports_by_iata;
+    CodeIndex airports_by_icao;
+    CodeIndex airlines_by_iata;
+    CodeIndex airlines_by_icao;
+    CodeIndex airlines_by_callsign;   // upper-cased
+    TrigramIndex airport_names;     // over name and city
+    TrigramIndex airline_names;     // over name and alias
+    std::vector<Route> routes;      // changed only through addRoute/eraseRoutes
+    RouteExistenceIndex route_index;
+    CountryMatrix country_matrix;
+    HubCounters hubs;
+    WeakComponents weak_components;
+
+    const Airport* airportByIata(const std::string& iata) const {
+        return lookup(airports, airports_by_iata, iata);
+    }
+
+    const Airport* airportByIcao(const std::string& icao) const {
+        return lookup(airports, airports_by_icao, icao);
+    }
+
+    const Airline* airlineByIcao(const std::string& icao) const {
+        return lookup(airlines, airlines_by_icao, icao);
+    }
+
+    const Airline* airlineByCallsign(const std::string& callsign) const {
+        return lookup(airlines, airlines_by_callsign, upperCase(callsign));
+    }
+
+private:
+    template <typename T>
+    static const T* lookup(const EntityTable<T>& table, const CodeIndex& index, const std::string& code) {
+        auto it = index.find(code);
+        return it == index.end() ? nullptr : &table.at(it->second);
+    }
+};
+
+// Global data containers, as loaded from the .dat files
+Dataset base;
 
 // Session-based modifications (not persisted)
-std::unordered_map<std::string, std::shared_ptr<Airport>> session_airports_by_iata;
-std::unordered_map<int, std::shared_ptr<Airport>> session_airports_by_id;
-std::unordered_map<std::string, std::shared_ptr<Airline>> session_airlines_by_iata;
-std::unordered_map<int, std::shared_ptr<Airline>> session_airlines_by_id;
-std::vector<std::shared_ptr<Route>> session_routes;
+Dataset session;
+
+// Guards the session containers: handlers take a shared lock to read and
+// a unique lock to modify, since Crow runs them on a worker pool
+std::shared_mutex session_mutex;
+
+// Bumped once per committed modification of the session data
+std::atomic<uint64_t> session_version{1};
 
 // Student information
 const std::string STUDENT_ID = "20606537";
@@ -166,107 +1123,880 @@ double calculateDistance(double lat1, double lon1, double lat2, double lon2) {
     return R * c;
 }
 
-// Load data from CSV files
-void loadAirports(const std::string& filename) {
-    std::ifstream file(filename);
-    std::string line;
-    
-    while (std::getline(file, line)) {
-        auto fields = parseCSVLine(line);
-        if (fields.size() >= 14) {
-            auto airport = std::make_shared<Airport>();
-            airport->id        = safe_stoi(fields[0]);
-            airport->name      = fields[1];
-            airport->city      = fields[2];
-            airport->country   = fields[3];
-            airport->iata      = fields[4];
-            airport->icao      = fields[5];
-            airport->latitude  = safe_stof(fields[6], 0.0f);
-            airport->longitude = safe_stof(fields[7], 0.0f);
-            airport->altitude  = safe_stoi(fields[8]);
-            airport->timezone  = safe_stof(fields[9], 0.0f);
-            airport->dst       = fields[10];
-            airport->tz_database = fields[11];
-            airport->type      = fields[12];
-            airport->source    = fields[13];
-            
-            if (!airport->iata.empty() && airport->iata != "\\N") {
-                airports_by_iata[airport->iata] = airport;
-            }
-            airports_by_id[airport->id] = airport;
-        }
-    }
+// Strict integer parse for ID columns: the whole field must be a number
+bool parseIntField(const std::string& s, int& out) {
+    const char* first = s.data();
+    const char* last  = s.data() + s.size();
+    auto res = std::from_chars(first, last, out);
+    return res.ec == std::errc() && res.ptr == last;
 }
 
-void loadAirlines(const std::string& filename) {
-    std::ifstream file(filename);
-    std::string line;
-    
-    while (std::getline(file, line)) {
-        auto fields = parseCSVLine(line);
-        if (fields.size() >= 8) {
-            auto airline = std::make_shared<Airline>();
-            airline->id      = safe_stoi(fields[0]);
-            airline->name    = fields[1];
-            airline->alias   = fields[2];
-            airline->iata    = fields[3];
-            airline->icao    = fields[4];
-            airline->callsign= fields[5];
-            airline->country = fields[6];
-            airline->active  = fields[7];
-            
-            if (!airline->iata.empty() && airline->iata != "\\N") {
-                airlines_by_iata[airline->iata] = airline;
-            }
-            airlines_by_id[airline->id] = airline;
-        }
+// Intern one field of a row; a full dictionary rejects the row
+bool internField(StringDictionary& dict, const std::string& value, uint16_t& code,
+                 const char* column, std::string& reason) {
+    if (dict.intern(value, code)) return true;
+    reason = tooManyValues(column);
+    return false;
+}
+
+// Row builders shared by the startup loaders and the bulk import.
+// Each fills one record from a parsed CSV line, or explains why it can't.
+bool buildAirport(const std::vector<std::string>& fields, Airport& airport, Dictionaries& dicts, std::string& reason) {
+    if (fields.size() < 14) {
+        reason = "expected 14 fields, got " + std::to_string(fields.size());
+        return false;
+    }
+    if (!parseIntField(fields[0], airport.id)) {
+        reason = "invalid airport ID '" + fields[0] + "'";
+        return false;
     }
+    airport.name      = fields[1];
+    airport.city      = fields[2];
+    airport.iata      = fields[4];
+    airport.icao      = fields[5];
+    airport.latitude  = safe_stof(fields[6], 0.0f);
+    airport.longitude = safe_stof(fields[7], 0.0f);
+    airport.altitude  = safe_stoi(fields[8]);
+    airport.timezone  = safe_stof(fields[9], 0.0f);
+    return internField(dicts.countries, fields[3], airport.country, "country", reason) &&
+           internField(dicts.dst, fields[10], airport.dst, "DST", reason) &&
+           internField(dicts.timezones, fields[11], airport.tz_database, "timezone", reason) &&
+           internField(dicts.airport_types, fields[12], airport.type, "type", reason) &&
+           internField(dicts.sources, fields[13], airport.source, "source", reason);
 }
 
-void loadRoutes(const std::string& filename) {
-    std::ifstream file(filename);
-    std::string line;
-    
-    while (std::getline(file, line)) {
-        auto fields = parseCSVLine(line);
-        if (fields.size() >= 9) {
-            auto route = std::make_shared<Route>();
-            route->airline_code      = fields[0];
-            route->airline_id        = safe_stoi(fields[1]);
-            route->source_airport    = fields[2];
-            route->source_airport_id = safe_stoi(fields[3]);
-            route->dest_airport      = fields[4];
-            route->dest_airport_id   = safe_stoi(fields[5]);
-            route->codeshare         = fields[6];
-            route->stops             = safe_stoi(fields[7]);
-            route->equipment         = fields[8];
-            
-            routes.push_back(route);
-        }
+bool buildAirline(const std::vector<std::string>& fields, Airline& airline, Dictionaries& dicts, std::string& reason) {
+    if (fields.size() < 8) {
+        reason = "expected 8 fields, got " + std::to_string(fields.size());
+        return false;
+    }
+    if (!parseIntField(fields[0], airline.id)) {
+        reason = "invalid airline ID '" + fields[0] + "'";
+        return false;
     }
+    airline.name    = fields[1];
+    airline.alias   = fields[2];
+    airline.iata    = fields[3];
+    airline.icao    = fields[4];
+    airline.callsign= fields[5];
+    return internField(dicts.countries, fields[6], airline.country, "country", reason) &&
+           internField(dicts.active, fields[7], airline.active, "active", reason);
 }
 
-// Initialize session data copies
-void initializeSession() {
-    session_airports_by_iata = airports_by_iata;
-    session_airports_by_id = airports_by_id;
-    session_airlines_by_iata = airlines_by_iata;
-    session_airlines_by_id = airlines_by_id;
-    session_routes = routes;
+bool buildRoute(const std::vector<std::string>& fields, Route& route, Dictionaries&, std::string& reason) {
+    if (fields.size() < 9) {
+        reason = "expected 9 fields, got " + std::to_string(fields.size());
+        return false;
+    }
+    if (fields[2].empty() || fields[4].empty()) {
+        reason = "missing source or destination airport";
+        return false;
+    }
+    route.airline_code      = fields[0];
+    route.airline_id        = safe_stoi(fields[1]);
+    route.source_airport    = fields[2];
+    route.source_airport_id = safe_stoi(fields[3]);
+    route.dest_airport      = fields[4];
+    route.dest_airport_id   = safe_stoi(fields[5]);
+    route.codeshare         = fields[6];
+    route.stops             = safe_stoi(fields[7]);
+    route.equipment         = fields[8];
+    return true;
 }
 
-// HTML helper functions
-std::string htmlHeader() {
-    return R"(
-<!DOCTYPE html>
-<html lang="en">
-<head>
-    <meta charset="UTF-8">
-    <meta name="viewport" content="width=device-width, initial-scale=1.0">
-    <title>OpenFlights Air Travel Database</title>
-    <style>
-        * { margin: 0; padding: 0; box-sizing: border-box; }
-        body {
+// A line of a .dat body that could not be turned into a record
+struct RejectedRow {
+    size_t line;
+    std::string reason;
+};
+
+template <typename T>
+struct ParseResult {
+    std::vector<T> records;
+    std::vector<size_t> lines;  // source line of each record
+    std::vector<RejectedRow> rejected;
+    Dictionaries dicts;         // what the records' coded fields refer to
+};
+
+// Parse an OpenFlights .dat body in parallel. The body is cut into
+// per-thread chunks on line boundaries; results are concatenated back in
+// file order so later rows still override earlier ones when indexed. Each
+// chunk interns into its own dictionaries, recoded while stitching.
+template <typename T, typename Builder>
+ParseResult<T> parseDatParallel(const std::string& data, Builder build) {
+    const size_t min_chunk_bytes = 64 * 1024;
+    size_t n_chunks = std::max(1u, std::thread::hardware_concurrency());
+    n_chunks = std::min(n_chunks, data.size() / min_chunk_bytes + 1);
+
+    std::vector<size_t> bounds{0};
+    for (size_t i = 1; i < n_chunks; i++) {
+        size_t pos = data.find('\n', std::max(bounds.back(), data.size() * i / n_chunks));
+        if (pos == std::string::npos) break;
+        bounds.push_back(pos + 1);
+    }
+    bounds.push_back(data.size());
+    n_chunks = bounds.size() - 1;
+
+    std::vector<ParseResult<T>> parts(n_chunks);
+    std::vector<size_t> line_counts(n_chunks, 0);
+
+    auto parseChunk = [&](size_t c) {
+        size_t pos = bounds[c];
+        while (pos < bounds[c + 1]) {
+            size_t eol = data.find('\n', pos);
+            if (eol == std::string::npos || eol > bounds[c + 1]) eol = bounds[c + 1];
+            std::string line = data.substr(pos, eol - pos);
+            pos = eol + 1;
+            line_counts[c]++;
+
+            if (trim(line).empty()) continue;
+
+            T record{};
+            std::string reason;
+            if (build(parseCSVLine(line), record, parts[c].dicts, reason)) {
+                parts[c].records.push_back(std::move(record));
+                parts[c].lines.push_back(line_counts[c]);
+            } else {
+                parts[c].rejected.push_back({line_counts[c], reason});
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t c = 1; c < n_chunks; c++) workers.emplace_back(parseChunk, c);
+    parseChunk(0);
+    for (auto& w : workers) w.join();
+
+    // Stitch chunks together, turning chunk-local line numbers into file
+    // ones. Chunks that fit on their own can still overflow together; rows
+    // whose values no longer fit are rejected here.
+    ParseResult<T> result;
+    size_t line_offset = 0;
+    for (size_t c = 0; c < n_chunks; c++) {
+        auto remap = result.dicts.absorb(parts[c].dicts);
+        for (size_t i = 0; i < parts[c].records.size(); i++) {
+            T& r = parts[c].records[i];
+            std::string reason;
+            if (recode(r, remap, reason)) {
+                result.records.push_back(std::move(r));
+                result.lines.push_back(parts[c].lines[i] + line_offset);
+            } else {
+                parts[c].rejected.push_back({parts[c].lines[i], reason});
+            }
+        }
+        std::sort(parts[c].rejected.begin(), parts[c].rejected.end(),
+            [](const RejectedRow& a, const RejectedRow& b) { return a.line < b.line; });
+        for (auto& r : parts[c].rejected) {
+            r.line += line_offset;
+            result.rejected.push_back(std::move(r));
+        }
+        line_offset += line_counts[c];
+    }
+    return result;
+}
+
+ParseResult<Airport> parseAirports(const std::string& data) {
+    return parseDatParallel<Airport>(data, buildAirport);
+}
+
+ParseResult<Airline> parseAirlines(const std::string& data) {
+    return parseDatParallel<Airline>(data, buildAirline);
+}
+
+ParseResult<Route> parseRoutes(const std::string& data) {
+    return parseDatParallel<Route>(data, buildRoute);
+}
+
+// Read a whole file into memory (empty if it can't be opened)
+std::string readFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// Take a record out of the code indexes
+void unbindAirport(Dataset& data, int32_t slot) {
+    const Airport& airport = data.airports.at(slot);
+    unbindCode(data.airports_by_iata, airport.iata, slot);
+    unbindCode(data.airports_by_icao, airport.icao, slot);
+}
+
+void unbindAirline(Dataset& data, int32_t slot) {
+    const Airline& airline = data.airlines.at(slot);
+    unbindCode(data.airlines_by_iata, airline.iata, slot);
+    unbindCode(data.airlines_by_icao, airline.icao, slot);
+    unbindCode(data.airlines_by_callsign, upperCase(airline.callsign), slot);
+}
+
+// Insert or replace a record by ID and index it under its codes and name
+void upsertAirport(Dataset& data, Airport airport) {
+    int32_t old_slot = data.airports.slotOf(airport.id);
+    if (old_slot != EntityTable<Airport>::NO_SLOT) unbindAirport(data, old_slot);
+
+    int32_t slot = data.airports.upsert(std::move(airport));
+    const Airport& stored = data.airports.at(slot);
+    bindCode(data.airports_by_iata, stored.iata, slot);
+    bindCode(data.airports_by_icao, stored.icao, slot);
+    data.airport_names.update(slot, searchText(stored));
+}
+
+void upsertAirline(Dataset& data, Airline airline) {
+    int32_t old_slot = data.airlines.slotOf(airline.id);
+    if (old_slot != EntityTable<Airline>::NO_SLOT) unbindAirline(data, old_slot);
+
+    int32_t slot = data.airlines.upsert(std::move(airline));
+    const Airline& stored = data.airlines.at(slot);
+    bindCode(data.airlines_by_iata, stored.iata, slot);
+    bindCode(data.airlines_by_icao, stored.icao, slot);
+    bindCode(data.airlines_by_callsign, upperCase(stored.callsign), slot);
+    data.airline_names.update(slot, searchText(stored));
+}
+
+// Country code of the airport behind an IATA code, 0 if unknown
+uint16_t airportCountry(const Dataset& data, const std::string& iata) {
+    const Airport* airport = data.airportByIata(iata);
+    return airport ? airport->country : 0;
+}
+
+// Route changes go through these two so the route indexes stay in step
+void addRoute(Dataset& data, Route route) {
+    route.source_country = airportCountry(data, route.source_airport);
+    route.dest_country = airportCountry(data, route.dest_airport);
+    data.route_index.add(route);
+    data.country_matrix.add(route);
+    data.hubs.add(route);
+    data.weak_components.add(route);
+    data.routes.push_back(std::move(route));
+}
+
+// Erase every route matching a predicate; returns how many went
+template <typename Pred>
+size_t eraseRoutes(Dataset& data, Pred matches) {
+    size_t before = data.routes.size();
+    data.routes.erase(
+        std::remove_if(data.routes.begin(), data.routes.end(), [&](const Route& r) {
+            if (!matches(r)) return false;
+            data.route_index.remove(r);
+            data.country_matrix.remove(r);
+            data.hubs.remove(r);
+            return true;
+        }),
+        data.routes.end());
+    if (data.routes.size() != before) data.weak_components.invalidate();
+    return before - data.routes.size();
+}
+
+// Re-resolve route endpoint countries after airports change. Only routes
+// whose join changed move between matrix cells and hub countries.
+void rejoinRouteCountries(Dataset& data) {
+    for (auto& route : data.routes) {
+        uint16_t source = airportCountry(data, route.source_airport);
+        uint16_t dest = airportCountry(data, route.dest_airport);
+        if (source == route.source_country && dest == route.dest_country) continue;
+        data.country_matrix.remove(route);
+        data.hubs.remove(route);
+        route.source_country = source;
+        route.dest_country = dest;
+        data.country_matrix.add(route);
+        data.hubs.add(route);
+    }
+}
+
+// Tombstone a record and drop it from every index
+void removeAirport(Dataset& data, int32_t slot) {
+    unbindAirport(data, slot);
+    data.airport_names.remove(slot);
+    data.airports.erase(slot);
+}
+
+void removeAirline(Dataset& data, int32_t slot) {
+    unbindAirline(data, slot);
+    data.airline_names.remove(slot);
+    data.airlines.erase(slot);
+}
+
+// Load data from CSV files. Each returns the number of records loaded.
+size_t loadAirports(Dataset& data, const std::string& filename) {
+    auto parsed = parseAirports(readFile(filename));
+    auto remap = data.dicts.absorb(parsed.dicts);
+    size_t loaded = 0;
+    for (auto& airport : parsed.records) {
+        std::string reason;
+        if (!recode(airport, remap, reason)) continue;
+        upsertAirport(data, std::move(airport));
+        loaded++;
+    }
+    rejoinRouteCountries(data);
+    size_t skipped = parsed.rejected.size() + parsed.records.size() - loaded;
+    if (skipped)
+        std::cout << filename << ": skipped " << skipped << " malformed rows\n";
+    return loaded;
+}
+
+size_t loadAirlines(Dataset& data, const std::string& filename) {
+    auto parsed = parseAirlines(readFile(filename));
+    auto remap = data.dicts.absorb(parsed.dicts);
+    size_t loaded = 0;
+    for (auto& airline : parsed.records) {
+        std::string reason;
+        if (!recode(airline, remap, reason)) continue;
+        upsertAirline(data, std::move(airline));
+        loaded++;
+    }
+    size_t skipped = parsed.rejected.size() + parsed.records.size() - loaded;
+    if (skipped)
+        std::cout << filename << ": skipped " << skipped << " malformed rows\n";
+    return loaded;
+}
+
+size_t loadRoutes(Dataset& data, const std::string& filename) {
+    auto parsed = parseRoutes(readFile(filename));
+    data.routes.reserve(data.routes.size() + parsed.records.size());
+    for (auto& route : parsed.records) {
+        addRoute(data, std::move(route));
+    }
+    if (!parsed.rejected.empty())
+        std::cout << filename << ": skipped " << parsed.rejected.size() << " malformed rows\n";
+    return parsed.records.size();
+}
+
+const std::string AIRPORTS_FILE = "airports.dat";
+const std::string AIRLINES_FILE = "airlines.dat";
+const std::string ROUTES_FILE   = "routes.dat";
+
+// Load all three data files; fails if any of them yields no records
+bool loadDataset(Dataset& data, std::string& error) {
+    if (!loadAirports(data, AIRPORTS_FILE)) error = AIRPORTS_FILE + " has no airports";
+    else if (!loadAirlines(data, AIRLINES_FILE)) error = AIRLINES_FILE + " has no airlines";
+    else if (!loadRoutes(data, ROUTES_FILE)) error = ROUTES_FILE + " has no routes";
+    return error.empty();
+}
+
+// Outcome of merging one uploaded .dat body into the session
+struct ImportReport {
+    std::string kind;
+    size_t accepted = 0;
+    std::vector<RejectedRow> rejected;
+};
+
+// Bulk import merges follow the startup loaders: records are upserted by
+// ID and the IATA index points at the last row seen for a code. Callers
+// check the dictionaries have room first, so recoding can't fail here.
+ImportReport mergeAirports(Dataset& data, const ParseResult<Airport>& parsed) {
+    ImportReport report{"airports", 0, parsed.rejected};
+    auto remap = data.dicts.absorb(parsed.dicts);
+    for (Airport airport : parsed.records) {
+        std::string reason;
+        if (!recode(airport, remap, reason)) continue;
+        upsertAirport(data, std::move(airport));
+        report.accepted++;
+    }
+    rejoinRouteCountries(data);
+    return report;
+}
+
+ImportReport mergeAirlines(Dataset& data, const ParseResult<Airline>& parsed) {
+    ImportReport report{"airlines", 0, parsed.rejected};
+    auto remap = data.dicts.absorb(parsed.dicts);
+    for (Airline airline : parsed.records) {
+        std::string reason;
+        if (!recode(airline, remap, reason)) continue;
+        upsertAirline(data, std::move(airline));
+        report.accepted++;
+    }
+    return report;
+}
+
+// Routes must connect airports the dataset knows about
+ImportReport mergeRoutes(Dataset& data, const ParseResult<Route>& parsed) {
+    ImportReport report{"routes", 0, parsed.rejected};
+    for (size_t i = 0; i < parsed.records.size(); i++) {
+        const auto& route = parsed.records[i];
+        std::string missing;
+        if (!data.airports_by_iata.count(route.source_airport))
+            missing = route.source_airport;
+        else if (!data.airports_by_iata.count(route.dest_airport))
+            missing = route.dest_airport;
+        if (!missing.empty()) {
+            report.rejected.push_back({parsed.lines[i], "unknown airport " + missing});
+            continue;
+        }
+        addRoute(data, route);
+        report.accepted++;
+    }
+    std::sort(report.rejected.begin(), report.rejected.end(),
+        [](const RejectedRow& a, const RejectedRow& b) { return a.line < b.line; });
+    return report;
+}
+
+// The parsed bodies of one /manage/import request
+struct ImportBatch {
+    std::optional<ParseResult<Airport>> airports;
+    std::optional<ParseResult<Airline>> airlines;
+    std::optional<ParseResult<Route>> routes;
+};
+
+// Airports go first so routes in the same upload can refer to them. An
+// upload whose values would overflow a dictionary is refused before
+// anything is merged; the error names the column.
+std::string mergeImport(Dataset& data, const ImportBatch& batch, std::vector<ImportReport>& reports) {
+    std::vector<const Dictionaries*> sources;
+    if (batch.airports) sources.push_back(&batch.airports->dicts);
+    if (batch.airlines) sources.push_back(&batch.airlines->dicts);
+    std::string column;
+    if (!data.dicts.canAbsorb(sources, column))
+        return "Too many distinct " + column + " values.";
+
+    if (batch.airports) reports.push_back(mergeAirports(data, *batch.airports));
+    if (batch.airlines) reports.push_back(mergeAirlines(data, *batch.airlines));
+    if (batch.routes)   reports.push_back(mergeRoutes(data, *batch.routes));
+    return "";
+}
+
+// Session operations. Each applies one /manage change to a dataset and
+// returns an error message, or an empty string on success.
+std::string insertAirline(Dataset& data, int id, const std::string& iata,
+                          const std::string& name, const std::string& country) {
+    if (data.airlines.find(id))
+        return "Airline ID already exists.";
+    if (data.airlines_by_iata.count(iata))
+        return "Airline IATA already exists.";
+
+    Airline al{};
+    if (!data.dicts.countries.intern(country, al.country))
+        return "Too many distinct country values.";
+    al.id      = id;
+    al.iata    = iata;
+    al.name    = name;
+
+    upsertAirline(data, std::move(al));
+    return "";
+}
+
+// Empty fields are left unchanged
+std::string modifyAirline(Dataset& data, const std::string& iata,
+                          const std::string& name, const std::string& country) {
+    auto it = data.airlines_by_iata.find(iata);
+    if (it == data.airlines_by_iata.end())
+        return "Airline not found.";
+
+    Airline& al = data.airlines.at(it->second);
+    uint16_t code = al.country;
+    if (!country.empty() && !data.dicts.countries.intern(country, code))
+        return "Too many distinct country values.";
+    if (!name.empty()) al.name = name;
+    al.country = code;
+    data.airline_names.update(it->second, searchText(al));
+    return "";
+}
+
+std::string deleteAirline(Dataset& data, const std::string& iata) {
+    auto it = data.airlines_by_iata.find(iata);
+    if (it == data.airlines_by_iata.end())
+        return "Airline not found.";
+
+    removeAirline(data, it->second);
+
+    eraseRoutes(data, [&](const Route& r) {
+        return r.airline_code == iata;
+    });
+    return "";
+}
+
+std::string insertAirport(Dataset& data, int id, const std::string& iata, const std::string& name,
+                          const std::string& city, const std::string& country) {
+    if (data.airports.find(id))
+        return "Airport ID already exists.";
+    if (data.airports_by_iata.count(iata))
+        return "Airport IATA already exists.";
+
+    Airport ap{};
+    if (!data.dicts.countries.intern(country, ap.country))
+        return "Too many distinct country values.";
+    ap.id      = id;
+    ap.iata    = iata;
+    ap.name    = name;
+    ap.city    = city;
+
+    upsertAirport(data, std::move(ap));
+    rejoinRouteCountries(data);
+    return "";
+}
+
+std::string modifyAirport(Dataset& data, const std::string& iata, const std::string& name,
+                          const std::string& city, const std::string& country) {
+    auto it = data.airports_by_iata.find(iata);
+    if (it == data.airports_by_iata.end())
+        return "Airport not found.";
+
+    Airport& ap = data.airports.at(it->second);
+    uint16_t code = ap.country;
+    if (!country.empty() && !data.dicts.countries.intern(country, code))
+        return "Too many distinct country values.";
+    if (!name.empty()) ap.name = name;
+    if (!city.empty()) ap.city = city;
+    ap.country = code;
+    data.airport_names.update(it->second, searchText(ap));
+    if (!country.empty()) rejoinRouteCountries(data);
+    return "";
+}
+
+std::string deleteAirport(Dataset& data, const std::string& iata) {
+    auto it = data.airports_by_iata.find(iata);
+    if (it == data.airports_by_iata.end())
+        return "Airport not found.";
+
+    removeAirport(data, it->second);
+
+    eraseRoutes(data, [&](const Route& r) {
+        return r.source_airport == iata ||
+               r.dest_airport   == iata;
+    });
+    rejoinRouteCountries(data);
+    return "";
+}
+
+std::string insertRoute(Dataset& data, const std::string& airline,
+                        const std::string& source, const std::string& dest) {
+    if (!data.airlines_by_iata.count(airline))
+        return "Airline not found.";
+    if (!data.airports_by_iata.count(source) || !data.airports_by_iata.count(dest))
+        return "Source or destination airport not found.";
+
+    Route r{};
+    r.airline_code   = airline;
+    r.source_airport = source;
+    r.dest_airport   = dest;
+    r.stops          = 0;
+
+    addRoute(data, std::move(r));
+    return "";
+}
+
+std::string deleteRoute(Dataset& data, const std::string& airline,
+                        const std::string& source, const std::string& dest) {
+    size_t erased = eraseRoutes(data, [&](const Route& r) {
+        return r.airline_code == airline &&
+               r.source_airport == source &&
+               r.dest_airport   == dest;
+    });
+
+    if (erased == 0)
+        return "No matching route found.";
+    return "";
+}
+
+// Every committed session operation, in order. A reload replays these on
+// top of the freshly loaded data so /manage changes survive it.
+using SessionOp = std::function<std::string(Dataset&)>;
+std::vector<SessionOp> session_journal;
+
+// Apply an operation to the session and journal it; returns the error, if any
+std::string commitSessionOp(const SessionOp& op) {
+    std::unique_lock<std::shared_mutex> lock(session_mutex);
+    std::string error = op(session);
+    if (error.empty()) {
+        session_journal.push_back(op);
+        session_version++;
+    }
+    return error;
+}
+
+// Initialize session data copies
+void initializeSession() {
+    session = base;
+}
+
+// Background reload state
+std::atomic<bool> reload_running{false};
+std::mutex reload_status_mutex;
+std::string reload_status = "No reload yet.";
+
+void setReloadStatus(const std::string& status) {
+    std::lock_guard<std::mutex> lock(reload_status_mutex);
+    reload_status = status;
+    std::cout << "Reload: " << status << "\n";
+}
+
+// Rebuild the data from the .dat files and swap it in. Parsing and
+// re-applying the session journal happen on private copies; the session
+// lock is only held exclusively to replay operations committed meanwhile
+// and to swap the datasets.
+void reloadData(const std::string& trigger) {
+    auto start = std::chrono::steady_clock::now();
+
+    auto fresh = std::make_unique<Dataset>();
+    std::string error;
+    if (!loadDataset(*fresh, error)) {
+        setReloadStatus("Reload (" + trigger + ") failed, keeping current data: " + error);
+        return;
+    }
+    auto staging = std::make_unique<Dataset>(*fresh);
+
+    std::vector<SessionOp> ops;
+    {
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        ops = session_journal;
+    }
+    size_t conflicts = 0;
+    for (const auto& op : ops)
+        if (!op(*staging).empty()) conflicts++;
+
+    uint64_t version;
+    {
+        std::unique_lock<std::shared_mutex> lock(session_mutex);
+        for (size_t i = ops.size(); i < session_journal.size(); i++)
+            if (!session_journal[i](*staging).empty()) conflicts++;
+        std::swap(base, *fresh);
+        std::swap(session, *staging);
+        version = ++session_version;
+    }
+    // The previous datasets are released here, outside the lock
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    setReloadStatus("Reloaded (" + trigger + ") in " + std::to_string(ms) + " ms as version " +
+                    std::to_string(version) + "; " + std::to_string(ops.size()) +
+                    " session changes re-applied, " + std::to_string(conflicts) + " no longer apply.");
+}
+
+// Start a background reload; false if one is already running
+bool startReload(const std::string& trigger) {
+    bool expected = false;
+    if (!reload_running.compare_exchange_strong(expected, true))
+        return false;
+    std::thread([trigger] {
+        reloadData(trigger);
+        reload_running = false;
+    }).detach();
+    return true;
+}
+
+// Poll the data files' modification times and reload when they change.
+// Polling keeps this portable; a change has to hold still for one interval
+// so a file that is still being written isn't picked up half-way.
+void watchDataFiles(int interval_seconds) {
+    auto stamp = [] {
+        std::vector<std::filesystem::file_time_type> times;
+        for (const auto& f : {AIRPORTS_FILE, AIRLINES_FILE, ROUTES_FILE}) {
+            std::error_code ec;
+            times.push_back(std::filesystem::last_write_time(f, ec));
+        }
+        return times;
+    };
+
+    auto seen = stamp();
+    auto pending = seen;
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::seconds(interval_seconds));
+        auto now = stamp();
+        if (now == seen) continue;
+        if (now != pending) {
+            pending = now;
+        } else if (startReload("data files changed")) {
+            seen = now;
+        }
+    }
+}
+
+// Approximate access counts for cache admission (a count-min sketch of
+// small saturating counters). Counts are halved periodically so keys that
+// were popular a while ago lose their advantage.
+class FrequencySketch {
+public:
+    explicit FrequencySketch(size_t width) : mask_(width - 1), counters_(4 * width, 0) {}
+
+    void increment(uint64_t hash) {
+        for (int row = 0; row < 4; row++) {
+            uint8_t& c = counters_[slot(hash, row)];
+            if (c < 15) c++;
+        }
+        if (++samples_ >= 10 * (mask_ + 1)) {
+            for (auto& c : counters_) c >>= 1;
+            samples_ = 0;
+        }
+    }
+
+    int estimate(uint64_t hash) const {
+        int result = 15;
+        for (int row = 0; row < 4; row++)
+            result = std::min<int>(result, counters_[slot(hash, row)]);
+        return result;
+    }
+
+private:
+    size_t slot(uint64_t hash, int row) const {
+        uint64_t h = (hash >> (16 * row)) * 0x9E3779B97F4A7C15ULL;
+        return row * (mask_ + 1) + ((h >> 32) & mask_);
+    }
+
+    size_t mask_;
+    size_t samples_ = 0;
+    std::vector<uint8_t> counters_;
+};
+
+// Sharded, byte-bounded cache of rendered pages. Each shard is an LRU with
+// TinyLFU admission: when a new page would force an eviction it is only
+// admitted if it has been asked for more often than the LRU victim. Every
+// page is tagged with the session version it was rendered at, and a shard
+// drops everything once it sees a newer version.
+class ResponseCache {
+public:
+    ResponseCache(size_t capacity_bytes, size_t shard_count)
+        : shard_capacity_(capacity_bytes / shard_count) {
+        for (size_t i = 0; i < shard_count; i++)
+            shards_.push_back(std::make_unique<Shard>());
+    }
+
+    bool get(const std::string& key, uint64_t version, std::string& value) {
+        uint64_t hash = std::hash<std::string>()(key);
+        Shard& shard = shardFor(hash);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        purgeIfStale(shard, version);
+        shard.sketch.increment(hash);
+
+        auto it = shard.index.find(key);
+        if (it == shard.index.end()) {
+            misses++;
+            return false;
+        }
+        shard.order.splice(shard.order.begin(), shard.order, it->second);
+        value = it->second->value;
+        hits++;
+        return true;
+    }
+
+    void put(const std::string& key, uint64_t version, const std::string& value) {
+        uint64_t hash = std::hash<std::string>()(key);
+        Shard& shard = shardFor(hash);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        purgeIfStale(shard, version);
+        if (version < shard.version || value.size() > shard_capacity_ || shard.index.count(key))
+            return;
+
+        int frequency = shard.sketch.estimate(hash);
+        while (shard.bytes + value.size() > shard_capacity_) {
+            auto& victim = shard.order.back();
+            if (frequency <= shard.sketch.estimate(victim.hash)) {
+                rejections++;
+                return;
+            }
+            shard.bytes -= victim.value.size();
+            shard.index.erase(victim.key);
+            shard.order.pop_back();
+            evictions++;
+        }
+
+        shard.order.push_front({key, value, hash});
+        shard.index[key] = shard.order.begin();
+        shard.bytes += value.size();
+        admissions++;
+    }
+
+    crow::json::wvalue stats() {
+        size_t entries = 0, bytes = 0;
+        for (auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            entries += shard->index.size();
+            bytes += shard->bytes;
+        }
+        crow::json::wvalue result;
+        result["entries"] = entries;
+        result["bytes"] = bytes;
+        result["capacity_bytes"] = shard_capacity_ * shards_.size();
+        result["shards"] = shards_.size();
+        result["hits"] = hits.load();
+        result["misses"] = misses.load();
+        result["admissions"] = admissions.load();
+        result["rejections"] = rejections.load();
+        result["evictions"] = evictions.load();
+        result["purges"] = purges.load();
+        return result;
+    }
+
+private:
+    struct Entry {
+        std::string key;
+        std::string value;
+        uint64_t hash;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        uint64_t version = 0;
+        size_t bytes = 0;
+        std::list<Entry> order;  // most recent first
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        FrequencySketch sketch{1024};
+    };
+
+    Shard& shardFor(uint64_t hash) {
+        return *shards_[(hash >> 56) % shards_.size()];
+    }
+
+    void purgeIfStale(Shard& shard, uint64_t version) {
+        if (version <= shard.version) return;
+        if (!shard.index.empty()) purges++;
+        shard.version = version;
+        shard.order.clear();
+        shard.index.clear();
+        shard.bytes = 0;
+    }
+
+    size_t shard_capacity_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<uint64_t> hits{0}, misses{0}, admissions{0}, rejections{0}, evictions{0}, purges{0};
+};
+
+// Collapses concurrent identical computations: the first caller for a key
+// runs it and every caller that arrives meanwhile waits for that result
+class SingleFlight {
+public:
+    std::string run(const std::string& key, const std::function<std::string()>& compute) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = in_flight_.find(key);
+        if (it != in_flight_.end()) {
+            auto pending = it->second;
+            lock.unlock();
+            return pending.get();
+        }
+        std::promise<std::string> promise;
+        in_flight_[key] = promise.get_future().share();
+        lock.unlock();
+
+        std::string result;
+        try {
+            result = compute();
+            promise.set_value(result);
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+            lock.lock();
+            in_flight_.erase(key);
+            throw;
+        }
+        lock.lock();
+        in_flight_.erase(key);
+        return result;
+    }
+
+private:
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_future<std::string>> in_flight_;
+};
+
+// HTML helper functions
+std::string htmlHeader() {
+    return R"(
+<!DOCTYPE html>
+<html lang="en">
+<head>
+    <meta charset="UTF-8">
+    <meta name="viewport" content="width=device-width, initial-scale=1.0">
+    <title>OpenFlights Air Travel Database</title>
+    <style>
+        * { margin: 0; padding: 0; box-sizing: border-box; }
+        body {
             font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif;
             background: linear-gradient(135deg, #667eea 0%, #764ba2 100%);
             min-height: 100vh;
@@ -428,98 +2158,2535 @@ std::string htmlHeader() {
             text-align: center;
             transition: transform 0.3s;
         }
-        .feature-card:hover {
-            transform: translateY(-5px);
+        .feature-card:hover {
+            transform: translateY(-5px);
+        }
+        .feature-card h3 {
+            margin-bottom: 10px;
+            font-size: 1.3em;
+        }
+        .code-display {
+            background: #2d2d2d;
+            color: #f8f8f2;
+            padding: 20px;
+            border-radius: 8px;
+            overflow-x: auto;
+            font-family: 'Courier New', monospace;
+            font-size: 0.9em;
+            line-height: 1.5;
+        }
+    </style>
+</head>
+<body>
+    <div class="container">
+        <div class="header">
+            <h1>✈️ OpenFlights Air Travel Database</h1>
+            <p>Comprehensive airline and airport data at your fingertips</p>
+        </div>
+        <div class="nav">
+            <div class="nav-grid">
+                <a href="/" class="nav-btn">🏠 Home</a>
+                <a href="/airline" class="nav-btn">✈️ Search Airline</a>
+                <a href="/airport" class="nav-btn">🛫 Search Airport</a>
+                <a href="/reports" class="nav-btn">📊 Reports</a>
+                <a href="/onehop" class="nav-btn">🔄 One-Hop Routes</a>
+                <a href="/manage" class="nav-btn">⚙️ Manage Data</a>
+                <a href="/code" class="nav-btn">💻 View Code</a>
+                <a href="/about" class="nav-btn">ℹ️ About</a>
+            </div>
+        </div>
+        <div class="content">
+)";
+}
+
+std::string htmlFooter() {
+    return R"(
+        </div>
+        <div class="footer">
+            <p>Created by )" + STUDENT_NAME + R"( (ID: )" + STUDENT_ID + R"()</p>
+            <p>CIS 22CH Honors Capstone Project | Powered by Crow C++ Framework</p>
+        </div>
+    </div>
+</body>
+</html>
+)";
+}
+
+// Escape text taken from a request before echoing it into a page
+std::string htmlEscape(const std::string& text) {
+    std::string out;
+    out.reserve(text.size());
+    for (char c : text) {
+        switch (c) {
+            case '&':  out += "&amp;"; break;
+            case '<':  out += "&lt;"; break;
+            case '>':  out += "&gt;"; break;
+            case '"':  out += "&quot;"; break;
+            case '\'': out += "&#39;"; break;
+            default:   out += c;
+        }
+    }
+    return out;
+}
+
+// Type-ahead for an IATA input: suggestions from /api/v1/autocomplete
+// fill a datalist as the user types
+std::string autocompleteScript(const std::string& input_id, const std::string& type) {
+    return R"(
+            <datalist id=")" + input_id + R"(-suggestions"></datalist>
+            <script>
+                (function () {
+                    var input = document.getElementById(')" + input_id + R"(');
+                    var list = document.getElementById(')" + input_id + R"(-suggestions');
+                    input.setAttribute('list', list.id);
+                    input.addEventListener('input', function () {
+                        if (!input.value) return;
+                        fetch('/api/v1/autocomplete?type=)" + type + R"(&limit=8&q=' + encodeURIComponent(input.value))
+                            .then(function (r) { return r.json(); })
+                            .then(function (data) {
+                                list.innerHTML = '';
+                                data.results.forEach(function (s) {
+                                    if (!s.iata) return;
+                                    var option = document.createElement('option');
+                                    option.value = s.iata;
+                                    option.label = s.name;
+                                    list.appendChild(option);
+                                });
+                            });
+                    });
+                })();
+            </script>
+    )";
+}
+
+std::string htmlMessagePage(const std::string& title,
+                            const std::string& message,
+                            const std::string& color = "#28a745") // green default
+{
+    std::string html = htmlHeader();
+
+    html += "<div class='result-box' style='border-left-color:" + color + ";'>";
+    html += "<h3>" + title + "</h3>";
+    html += "<p>" + message + "</p>";
+    html += "</div>";
+
+    html += "<p><a href='/manage' class='btn'>← Back to Manage Page</a></p>";
+
+    html += htmlFooter();
+    return html;
+}
+
+inline std::string successPage(const std::string& msg)
+{
+    return htmlMessagePage("Success", msg, "#28a745");  // green
+}
+
+inline std::string errorPage(const std::string& msg)
+{
+    return htmlMessagePage("Error", msg, "#dc3545");   // red
+}
+
+// Rendered pages of the search and report endpoints. They are pure
+// functions of their normalized parameters and the session version.
+size_t responseCacheBytes() {
+    size_t mb = 64;
+    if (const char* env_p = std::getenv("RESPONSE_CACHE_MB")) {
+        mb = safe_stoi(env_p, 64);
+    }
+    return mb * 1024 * 1024;
+}
+
+ResponseCache response_cache(responseCacheBytes(), 16);
+SingleFlight render_flight;
+
+// Cache key part for an optional query parameter, normalized to upper case
+std::string cacheKeyParam(const char* value) {
+    if (!value) return "-";
+    std::string param = value;
+    std::transform(param.begin(), param.end(), param.begin(), ::toupper);
+    return "=" + param;
+}
+
+// Optional boolean parameter: present and not 0, false or no
+bool queryFlag(const crow::request& req, const char* name) {
+    const char* value = req.url_params.get(name);
+    if (!value) return false;
+    std::string flag = value;
+    std::transform(flag.begin(), flag.end(), flag.begin(), ::tolower);
+    return flag != "0" && flag != "false" && flag != "no";
+}
+
+// Optional ?limit= parameter, clamped to [1, max_limit]
+size_t queryLimit(const crow::request& req, size_t def, size_t max_limit) {
+    const char* value = req.url_params.get("limit");
+    if (!value) return def;
+    int limit = safe_stoi(value, (int)def);
+    return std::min<size_t>(std::max(limit, 1), max_limit);
+}
+
+// Full JSON views of records, as returned by the /api/v1 lookups
+crow::json::wvalue airportJson(const Dataset& data, const Airport& airport) {
+    crow::json::wvalue item;
+    item["id"] = airport.id;
+    item["name"] = airport.name;
+    item["city"] = airport.city;
+    item["country"] = data.dicts.countries.lookup(airport.country);
+    item["iata"] = airport.iata;
+    item["icao"] = airport.icao;
+    item["latitude"] = airport.latitude;
+    item["longitude"] = airport.longitude;
+    item["altitude"] = airport.altitude;
+    item["timezone"] = airport.timezone;
+    item["dst"] = data.dicts.dst.lookup(airport.dst);
+    item["tz_database"] = data.dicts.timezones.lookup(airport.tz_database);
+    item["type"] = data.dicts.airport_types.lookup(airport.type);
+    item["source"] = data.dicts.sources.lookup(airport.source);
+    return item;
+}
+
+crow::json::wvalue airlineJson(const Dataset& data, const Airline& airline) {
+    crow::json::wvalue item;
+    item["id"] = airline.id;
+    item["name"] = airline.name;
+    item["alias"] = airline.alias;
+    item["iata"] = airline.iata;
+    item["icao"] = airline.icao;
+    item["callsign"] = airline.callsign;
+    item["country"] = data.dicts.countries.lookup(airline.country);
+    item["active"] = data.dicts.active.lookup(airline.active);
+    return item;
+}
+
+crow::json::wvalue routeJson(const Route& route) {
+    crow::json::wvalue item;
+    item["airline"] = route.airline_code;
+    item["airline_id"] = route.airline_id;
+    item["source"] = route.source_airport;
+    item["dest"] = route.dest_airport;
+    item["codeshare"] = route.codeshare;
+    item["stops"] = route.stops;
+    item["equipment"] = route.equipment;
+    return item;
+}
+
+// JSON error body with a status code
+crow::response jsonError(int code, const std::string& message) {
+    crow::json::wvalue result;
+    result["error"] = message;
+    return crow::response(code, result);
+}
+
+// An OpenFlights ID given as a JSON number. Fractions, exponents and
+// values outside int aren't IDs.
+bool jsonIdKey(const crow::json::rvalue& key, int& id) {
+    if (key.t() != crow::json::type::Number) return false;
+    if (key.nt() != crow::json::num_type::Signed_integer && key.nt() != crow::json::num_type::Unsigned_integer)
+        return false;
+    double value = key.d();
+    if (value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max()) return false;
+    id = static_cast<int>(key.i());
+    return true;
+}
+
+// Serve a page from the response cache. On a miss the page is rendered
+// once, however many identical requests are waiting for it.
+std::string cachedPage(const std::string& key, const std::function<std::string()>& render) {
+    uint64_t version = session_version.load();
+    std::string page;
+    if (response_cache.get(key, version, page))
+        return page;
+    return render_flight.run(key + "|" + std::to_string(version), [&] {
+        std::string rendered = render();
+        response_cache.put(key, version, rendered);
+        return rendered;
+    });
+}
+
+// A structure derived from the session data, built on first use and
+// rebuilt once the session version moves on. Callers hold the session
+// lock, shared or unique, so the data can't change during a build.
+template <typename T>
+class VersionedCache {
+public:
+    explicit VersionedCache(std::function<T(const Dataset&)> build) : build_(std::move(build)) {}
+
+    std::shared_ptr<const T> get(const Dataset& data, uint64_t version) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!value_ || version_ != version) {
+            value_ = std::make_shared<const T>(build_(data));
+            version_ = version;
+        }
+        return value_;
+    }
+
+private:
+    std::function<T(const Dataset&)> build_;
+    std::mutex mutex_;
+    uint64_t version_ = 0;
+    std::shared_ptr<const T> value_;
+};
+
+// Lower-case ASCII letters, leaving other bytes alone
+std::string toLowerAscii(std::string text) {
+    for (char& c : text)
+        if (c >= 'A' && c <= 'Z') c = c - 'A' + 'a';
+    return text;
+}
+
+// Usable IATA/ICAO code, or empty
+std::string codeKey(const std::string& code) {
+    return code == "\\N" ? "" : code;
+}
+
+// Type-ahead index: lower-cased keys in one sorted array, so the keys
+// starting with a prefix form a contiguous range. A sparse table over the
+// route counts finds the busiest entry of any range in O(1), and the top
+// k of a range are pulled from a small heap of sub-ranges without
+// scanning the whole range.
+class PrefixIndex {
+public:
+    struct Entry {
+        std::string key;
+        int32_t slot;
+        uint32_t routes;
+    };
+
+    // Records whose IATA code appears in no route still get a count of 0
+    template <typename T, typename KeysOf>
+    PrefixIndex(const EntityTable<T>& table,
+                const std::unordered_map<std::string, uint32_t>& routes_by_iata,
+                KeysOf keys_of) {
+        table.forEach([&](int32_t slot, const T& record) {
+            auto it = routes_by_iata.find(codeKey(record.iata));
+            uint32_t routes = it == routes_by_iata.end() ? 0 : it->second;
+            for (auto& key : keys_of(record))
+                if (!key.empty()) entries_.push_back({toLowerAscii(std::move(key)), slot, routes});
+        });
+        std::sort(entries_.begin(), entries_.end(),
+                  [](const Entry& a, const Entry& b) {
+                      return a.key != b.key ? a.key < b.key : a.slot < b.slot;
+                  });
+
+        sparse_.emplace_back(entries_.size());
+        for (uint32_t i = 0; i < entries_.size(); i++) sparse_[0][i] = i;
+        for (size_t width = 2; width <= entries_.size(); width *= 2) {
+            const auto& prev = sparse_.back();
+            std::vector<uint32_t> level(entries_.size() - width + 1);
+            for (size_t i = 0; i < level.size(); i++)
+                level[i] = busier(prev[i], prev[i + width / 2]);
+            sparse_.push_back(std::move(level));
+        }
+    }
+
+    // Up to `limit` distinct records with a key starting with `prefix`,
+    // busiest first
+    std::vector<const Entry*> complete(const std::string& prefix, size_t limit) const {
+        std::vector<const Entry*> out;
+        std::string lower = toLowerAscii(prefix);
+        auto lo = std::lower_bound(entries_.begin(), entries_.end(), lower,
+                                   [](const Entry& e, const std::string& p) { return e.key < p; });
+        // Keys are sorted, so those past the prefix range compare greater
+        // on their first prefix-length characters
+        auto hi = std::upper_bound(lo, entries_.end(), lower, [](const std::string& p, const Entry& e) {
+            return e.key.compare(0, p.size(), p) > 0;
+        });
+        if (lo == hi) return out;
+
+        // Heap of [first, last] ranges keyed by their busiest entry
+        struct Range { uint32_t best, first, last; };
+        auto cmp = [&](const Range& a, const Range& b) { return busier(a.best, b.best) == b.best; };
+        std::vector<Range> heap;
+        auto push = [&](uint32_t first, uint32_t last) {
+            if (first > last) return;
+            heap.push_back({best(first, last), first, last});
+            std::push_heap(heap.begin(), heap.end(), cmp);
+        };
+        push(lo - entries_.begin(), hi - entries_.begin() - 1);
+
+        std::vector<int32_t> seen;
+        while (!heap.empty() && out.size() < limit) {
+            std::pop_heap(heap.begin(), heap.end(), cmp);
+            Range r = heap.back();
+            heap.pop_back();
+            const Entry& e = entries_[r.best];
+            if (std::find(seen.begin(), seen.end(), e.slot) == seen.end()) {
+                seen.push_back(e.slot);
+                out.push_back(&e);
+            }
+            if (r.best > r.first) push(r.first, r.best - 1);
+            push(r.best + 1, r.last);
+        }
+        return out;
+    }
+
+private:
+    // More routes wins; ties go to the key that sorts first
+    uint32_t busier(uint32_t a, uint32_t b) const {
+        if (entries_[a].routes != entries_[b].routes)
+            return entries_[a].routes > entries_[b].routes ? a : b;
+        return std::min(a, b);
+    }
+
+    uint32_t best(uint32_t first, uint32_t last) const {
+        size_t level = 0;
+        while ((size_t(2) << level) <= last - first + 1) level++;
+        return busier(sparse_[level][first], sparse_[level][last + 1 - (size_t(1) << level)]);
+    }
+
+    std::vector<Entry> entries_;
+    std::vector<std::vector<uint32_t>> sparse_;
+};
+
+// Every word start of a name, so "heath" finds "London Heathrow Airport"
+void addWordStarts(std::vector<std::string>& keys, const std::string& text) {
+    for (size_t i = 0; i < text.size(); i++) {
+        bool starts = std::isalnum((unsigned char)text[i]) &&
+                      (i == 0 || !std::isalnum((unsigned char)text[i - 1]));
+        if (starts) keys.push_back(text.substr(i));
+    }
+}
+
+// Route counts per airport code and per airline code
+struct RouteCounts {
+    std::unordered_map<std::string, uint32_t> airports;
+    std::unordered_map<std::string, uint32_t> airlines;
+};
+
+RouteCounts countRoutes(const Dataset& data) {
+    RouteCounts counts;
+    for (const auto& route : data.routes) {
+        counts.airports[route.source_airport]++;
+        counts.airports[route.dest_airport]++;
+        counts.airlines[route.airline_code]++;
+    }
+    return counts;
+}
+
+struct AutocompleteIndex {
+    PrefixIndex airports;
+    PrefixIndex airlines;
+};
+
+AutocompleteIndex buildAutocomplete(const Dataset& data) {
+    RouteCounts counts = countRoutes(data);
+    return AutocompleteIndex{
+        PrefixIndex(data.airports, counts.airports, [](const Airport& airport) {
+            std::vector<std::string> keys{codeKey(airport.iata), codeKey(airport.icao)};
+            addWordStarts(keys, airport.name);
+            addWordStarts(keys, airport.city);
+            return keys;
+        }),
+        PrefixIndex(data.airlines, counts.airlines, [](const Airline& airline) {
+            std::vector<std::string> keys{codeKey(airline.iata), codeKey(airline.icao)};
+            addWordStarts(keys, airline.name);
+            return keys;
+        }),
+    };
+}
+
+VersionedCache<AutocompleteIndex> autocomplete_index(buildAutocomplete);
+
+// Every airline under each IATA code, including those airlines_by_iata
+// loses to a later row with the same code. Codes are sorted, and each one
+// owns a contiguous range of slots with active airlines first, so an
+// ambiguous lookup is a single range read.
+class AirlineCodeIndex {
+public:
+    explicit AirlineCodeIndex(const Dataset& data) {
+        std::vector<std::pair<std::string, int32_t>> pairs;
+        data.airlines.forEach([&](int32_t slot, const Airline& airline) {
+            if (!airline.iata.empty() && airline.iata != "\\N") pairs.push_back({airline.iata, slot});
+        });
+        auto active = [&](int32_t slot) { return data.dicts.active.lookup(data.airlines.at(slot).active) == "Y"; };
+        std::sort(pairs.begin(), pairs.end(), [&](const auto& a, const auto& b) {
+            if (a.first != b.first) return a.first < b.first;
+            if (active(a.second) != active(b.second)) return active(a.second);
+            return data.airlines.at(a.second).id < data.airlines.at(b.second).id;
+        });
+
+        for (const auto& [code, slot] : pairs) {
+            if (codes_.empty() || codes_.back() != code) {
+                codes_.push_back(code);
+                offsets_.push_back(static_cast<uint32_t>(slots_.size()));
+            }
+            slots_.push_back(slot);
+        }
+        offsets_.push_back(static_cast<uint32_t>(slots_.size()));
+    }
+
+    struct Range {
+        const int32_t* first;
+        const int32_t* last;
+        const int32_t* begin() const { return first; }
+        const int32_t* end() const { return last; }
+        size_t size() const { return last - first; }
+    };
+
+    Range find(const std::string& code) const {
+        auto it = std::lower_bound(codes_.begin(), codes_.end(), code);
+        if (it == codes_.end() || *it != code) return {nullptr, nullptr};
+        return rangeAt(it - codes_.begin());
+    }
+
+    // The airline a single-airline lookup means by a code: the first of
+    // its range, so an active airline wins over defunct ones
+    const Airline* primary(const Dataset& data, const std::string& code) const {
+        Range range = find(code);
+        return range.size() > 0 ? &data.airlines.at(*range.begin()) : nullptr;
+    }
+
+    // All slots, ordered by code and then as find() returns them
+    const std::vector<int32_t>& slots() const { return slots_; }
+
+private:
+    Range rangeAt(size_t i) const {
+        return {slots_.data() + offsets_[i], slots_.data() + offsets_[i + 1]};
+    }
+
+    std::vector<std::string> codes_;
+    std::vector<uint32_t> offsets_;
+    std::vector<int32_t> slots_;
+};
+
+VersionedCache<AirlineCodeIndex> airline_codes([](const Dataset& data) { return AirlineCodeIndex(data); });
+
+// Position of a row in a report order: by text, then number, then ID.
+// The ID makes every key unique, so a key names exactly one row.
+struct SortKey {
+    std::string text;
+    long long number = 0;
+    int id = 0;
+
+    bool operator<(const SortKey& other) const {
+        return std::tie(text, number, id) < std::tie(other.text, other.number, other.id);
+    }
+};
+
+// Keyset cursors name the last row of a page as "number:id:text"
+std::string encodeCursor(const SortKey& key) {
+    return std::to_string(key.number) + ":" + std::to_string(key.id) + ":" + key.text;
+}
+
+bool decodeCursor(const std::string& cursor, SortKey& key) {
+    size_t first = cursor.find(':');
+    if (first == std::string::npos) return false;
+    size_t second = cursor.find(':', first + 1);
+    if (second == std::string::npos) return false;
+    const char* begin = cursor.data();
+    auto number = std::from_chars(begin, begin + first, key.number);
+    if (number.ec != std::errc() || number.ptr != begin + first) return false;
+    if (!parseIntField(cursor.substr(first + 1, second - first - 1), key.id)) return false;
+    key.text = cursor.substr(second + 1);
+    return true;
+}
+
+enum ReportSort { SORT_IATA, SORT_NAME, SORT_COUNTRY, SORT_ROUTES, SORT_KINDS };
+
+const char* const REPORT_SORT_NAMES[SORT_KINDS] = {"iata", "name", "country", "routes"};
+const char* const REPORT_SORT_LABELS[SORT_KINDS] = {"IATA Code", "Name", "Country", "Route Count"};
+
+// Report rows in one sort order, with the key of each row alongside
+struct ReportOrder {
+    std::vector<int32_t> slots;
+    std::vector<SortKey> keys;
+
+    // Index of the first row after a cursor key
+    size_t after(const SortKey& key) const {
+        return std::upper_bound(keys.begin(), keys.end(), key) - keys.begin();
+    }
+};
+
+template <typename KeyOf>
+ReportOrder buildReportOrder(const std::vector<int32_t>& slots, KeyOf key_of) {
+    std::vector<std::pair<SortKey, int32_t>> rows;
+    rows.reserve(slots.size());
+    for (int32_t slot : slots) rows.push_back({key_of(slot), slot});
+    std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    ReportOrder order;
+    order.slots.reserve(rows.size());
+    order.keys.reserve(rows.size());
+    for (auto& [key, slot] : rows) {
+        order.keys.push_back(std::move(key));
+        order.slots.push_back(slot);
+    }
+    return order;
+}
+
+// Every sort order of the airport and airline reports. Airports are those
+// with an IATA code; airlines are all with a code, including ones sharing
+// it. The IATA order of airlines matches the code index: active first,
+// then ID. Route counts sort descending.
+struct ReportOrders {
+    ReportOrder airports[SORT_KINDS];
+    ReportOrder airlines[SORT_KINDS];
+};
+
+ReportOrders buildReportOrders(const Dataset& data) {
+    RouteCounts counts = countRoutes(data);
+    auto routes = [](const std::unordered_map<std::string, uint32_t>& map, const std::string& code) {
+        auto it = map.find(code);
+        return it == map.end() ? 0LL : (long long)it->second;
+    };
+
+    std::vector<int32_t> airport_slots;
+    for (const auto& pair : data.airports_by_iata) airport_slots.push_back(pair.second);
+    std::vector<int32_t> airline_slots;
+    data.airlines.forEach([&](int32_t slot, const Airline& airline) {
+        if (!airline.iata.empty() && airline.iata != "\\N") airline_slots.push_back(slot);
+    });
+
+    ReportOrders orders;
+    for (int sort = 0; sort < SORT_KINDS; sort++) {
+        orders.airports[sort] = buildReportOrder(airport_slots, [&](int32_t slot) {
+            const Airport& airport = data.airports.at(slot);
+            switch (sort) {
+                case SORT_IATA:    return SortKey{airport.iata, 0, airport.id};
+                case SORT_NAME:    return SortKey{airport.name, 0, airport.id};
+                case SORT_COUNTRY: return SortKey{data.dicts.countries.lookup(airport.country), 0, airport.id};
+                default:           return SortKey{"", -routes(counts.airports, airport.iata), airport.id};
+            }
+        });
+        orders.airlines[sort] = buildReportOrder(airline_slots, [&](int32_t slot) {
+            const Airline& airline = data.airlines.at(slot);
+            switch (sort) {
+                case SORT_IATA: {
+                    bool inactive = data.dicts.active.lookup(airline.active) != "Y";
+                    return SortKey{airline.iata, inactive ? 1 : 0, airline.id};
+                }
+                case SORT_NAME:    return SortKey{airline.name, 0, airline.id};
+                case SORT_COUNTRY: return SortKey{data.dicts.countries.lookup(airline.country), 0, airline.id};
+                default:           return SortKey{"", -routes(counts.airlines, airline.iata), airline.id};
+            }
+        });
+    }
+    return orders;
+}
+
+VersionedCache<ReportOrders> report_orders(buildReportOrders);
+
+// Parsed ?sort=&limit=&after= of a table report. A limit of 0 means every
+// row after the cursor.
+struct ReportQuery {
+    ReportSort sort = SORT_IATA;
+    size_t limit = 0;
+    std::optional<SortKey> after;
+    std::string error;
+};
+
+ReportQuery parseReportQuery(const crow::request& req, size_t def_limit, size_t max_limit) {
+    ReportQuery query;
+    if (const char* sort = req.url_params.get("sort"); sort && *sort) {
+        auto it = std::find_if(std::begin(REPORT_SORT_NAMES), std::end(REPORT_SORT_NAMES),
+                               [&](const char* name) { return std::strcmp(name, sort) == 0; });
+        if (it == std::end(REPORT_SORT_NAMES)) {
+            query.error = "sort must be one of iata, name, country, routes";
+            return query;
+        }
+        query.sort = static_cast<ReportSort>(it - std::begin(REPORT_SORT_NAMES));
+    }
+    const char* limit = req.url_params.get("limit");
+    query.limit = (limit && *limit) ? queryLimit(req, def_limit, max_limit) : def_limit;
+    if (const char* after = req.url_params.get("after"); after && *after) {
+        SortKey key;
+        if (!decodeCursor(after, key)) {
+            query.error = "invalid after cursor";
+            return query;
+        }
+        query.after = key;
+    }
+    return query;
+}
+
+// Body producer for a streamed report: the page head, then table rows in
+// batches, then the page foot. Each batch takes the session lock afresh
+// and resumes after the sort key of the last row sent, so the lock isn't
+// held while the client reads and a change in between doesn't make the
+// stream skip or repeat rows.
+std::function<bool(std::string&)> streamReport(
+        std::string head, std::string foot,
+        std::function<const ReportOrder&(const ReportOrders&)> pick,
+        std::optional<SortKey> after,
+        std::function<std::string(int32_t)> render_row) {
+    const size_t rows_per_chunk = 256;
+    struct State {
+        bool head_sent = false;
+        bool rows_done = false;
+        std::optional<SortKey> last;
+    };
+    auto state = std::make_shared<State>();
+    state->last = std::move(after);
+
+    return [=](std::string& chunk) {
+        if (!state->head_sent) {
+            chunk = head;
+            state->head_sent = true;
+            return true;
+        }
+        if (state->rows_done) {
+            chunk = foot;
+            return false;
+        }
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        auto orders = report_orders.get(session, session_version.load());
+        const ReportOrder& order = pick(*orders);
+        size_t first = state->last ? order.after(*state->last) : 0;
+        size_t last = std::min(first + rows_per_chunk, order.slots.size());
+        for (size_t i = first; i < last; i++) chunk += render_row(order.slots[i]);
+        if (last != first) state->last = order.keys[last - 1];
+        state->rows_done = last == order.slots.size();
+        return true;
+    };
+}
+
+// HTML table report over one report order. With ?limit= it renders a
+// single page and links the next one; otherwise it streams every row.
+crow::response tableReport(const crow::request& req, const std::string& path, bool airlines,
+                           const std::string& title, const std::string& columns,
+                           std::function<std::string(int32_t)> render_row) {
+    const char* limit_param = req.url_params.get("limit");
+    bool paged = limit_param && *limit_param;
+    ReportQuery query = parseReportQuery(req, 0, 1000);
+    if (!query.error.empty()) return crow::response(400, query.error);
+    auto pick = [airlines, sort = query.sort](const ReportOrders& orders) -> const ReportOrder& {
+        return airlines ? orders.airlines[sort] : orders.airports[sort];
+    };
+
+    std::string rows, next;
+    size_t total;
+    {
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        auto orders = report_orders.get(session, session_version.load());
+        const ReportOrder& order = pick(*orders);
+        total = order.slots.size();
+        if (paged) {
+            size_t first = query.after ? order.after(*query.after) : 0;
+            size_t last = std::min(first + query.limit, total);
+            for (size_t i = first; i < last; i++) rows += render_row(order.slots[i]);
+            if (last < total) next = encodeCursor(order.keys[last - 1]);
+        }
+    }
+
+    std::string html = htmlHeader();
+    html += "<h2>📊 All " + title + " (Ordered by " + REPORT_SORT_LABELS[query.sort] + ")</h2>";
+    html += "<div class='result-box'>";
+    html += "<p>Total " + title + ": " + std::to_string(total) + "</p>";
+    html += "<table><thead><tr>" + columns + "</tr></thead><tbody>";
+
+    std::string foot = "</tbody></table></div>";
+    if (!next.empty()) {
+        foot += "<p><a href='" + path + "?sort=" + REPORT_SORT_NAMES[query.sort] +
+                "&limit=" + std::to_string(query.limit) + "&after=" + urlEncode(next) +
+                "' class='btn'>Next Page ➡</a></p>";
+    }
+    foot += "<p><a href='/reports' class='btn'>🔙 Back to Reports</a></p>";
+    foot += htmlFooter();
+
+    if (paged) return crow::response(html + rows + foot);
+    crow::response res;
+    res.set_header("Content-Type", "text/html");
+    res.set_chunked_body(streamReport(html, foot, pick, query.after, render_row));
+    return res;
+}
+
+// JSON page of a report order: {"sort", "total", "items", "next"}, where
+// next is the cursor for ?after= or null on the last page
+crow::response jsonReport(const crow::request& req, bool airlines) {
+    ReportQuery query = parseReportQuery(req, 100, 1000);
+    if (!query.error.empty()) return jsonError(400, query.error);
+
+    std::shared_lock<std::shared_mutex> lock(session_mutex);
+    auto orders = report_orders.get(session, session_version.load());
+    const ReportOrder& order = airlines ? orders->airlines[query.sort] : orders->airports[query.sort];
+    size_t first = query.after ? order.after(*query.after) : 0;
+    size_t last = std::min(first + query.limit, order.slots.size());
+
+    crow::json::wvalue result;
+    result["sort"] = REPORT_SORT_NAMES[query.sort];
+    result["total"] = order.slots.size();
+    result["items"] = crow::json::wvalue::list();
+    for (size_t i = first; i < last; i++) {
+        int32_t slot = order.slots[i];
+        result["items"][i - first] = airlines ? airlineJson(session, session.airlines.at(slot))
+                                              : airportJson(session, session.airports.at(slot));
+    }
+    if (last < order.slots.size()) result["next"] = encodeCursor(order.keys[last - 1]);
+    else result["next"] = nullptr;
+    return crow::response(result);
+}
+
+// LSD radix sort of 64-bit keys, one byte per pass. Passes where every key
+// has the same byte are skipped, so small counts cost few passes.
+void radixSort(std::vector<uint64_t>& keys) {
+    std::vector<uint64_t> buffer(keys.size());
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t counts[257] = {};
+        for (uint64_t key : keys) counts[((key >> shift) & 0xff) + 1]++;
+        if (std::find(counts + 1, counts + 257, keys.size()) != counts + 257) continue;
+        for (int i = 1; i <= 256; i++) counts[i] += counts[i - 1];
+        for (uint64_t key : keys) buffer[counts[(key >> shift) & 0xff]++] = key;
+        keys.swap(buffer);
+    }
+}
+
+// Rank per-code route tallies by count descending, then code. A tally
+// packs into one integer, inverted count above the code's first four
+// bytes, so ranking is integer work: a radix sort for the full list, or
+// nth_element plus a sort of the first top keys when top is set. Codes
+// too long to pack fall back to a comparison sort.
+std::vector<std::pair<std::string, int>> rankTallies(const std::unordered_map<std::string, int>& tallies,
+                                                     size_t top) {
+    std::vector<std::pair<std::string, int>> ranked;
+    size_t n = (top && top < tallies.size()) ? top : tallies.size();
+    ranked.reserve(n);
+
+    bool packable = std::all_of(tallies.begin(), tallies.end(), [](const auto& t) {
+        return t.first.size() <= 4 && t.second >= 0;
+    });
+    if (!packable) {
+        ranked.assign(tallies.begin(), tallies.end());
+        auto before = [](const auto& a, const auto& b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        };
+        std::partial_sort(ranked.begin(), ranked.begin() + n, ranked.end(), before);
+        ranked.resize(n);
+        return ranked;
+    }
+
+    std::vector<uint64_t> keys;
+    keys.reserve(tallies.size());
+    for (const auto& [code, count] : tallies) {
+        uint64_t packed = 0;
+        for (size_t i = 0; i < 4; i++) packed = (packed << 8) | (i < code.size() ? (uint8_t)code[i] : 0);
+        keys.push_back((uint64_t)(UINT32_MAX - (uint32_t)count) << 32 | packed);
+    }
+    if (n < keys.size()) {
+        std::nth_element(keys.begin(), keys.begin() + n, keys.end());
+        keys.resize(n);
+        std::sort(keys.begin(), keys.end());
+    } else {
+        radixSort(keys);
+    }
+
+    for (uint64_t key : keys) {
+        std::string code;
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            if (char c = (char)((key >> shift) & 0xff)) code.push_back(c);
+        }
+        ranked.push_back({code, (int)(UINT32_MAX - (uint32_t)(key >> 32))});
+    }
+    return ranked;
+}
+
+// Optional ?top= parameter of the route reports; 0 keeps every row
+size_t queryTop(const crow::request& req) {
+    const char* value = req.url_params.get("top");
+    if (!value || !*value) return 0;
+    return (size_t)std::max(safe_stoi(value, 0), 0);
+}
+
+// The distinct aircraft type codes of a route's space-separated
+// equipment field, in the order they first appear
+std::vector<std::string> equipmentCodes(const std::string& field) {
+    std::vector<std::string> codes;
+    std::stringstream equipment(field);
+    std::string code;
+    while (equipment >> code) {
+        if (std::find(codes.begin(), codes.end(), code) == codes.end()) codes.push_back(code);
+    }
+    return codes;
+}
+
+// Columnar, dictionary-coded copy of the route table for scans. Each
+// column is one uint16_t code per route, with its own dictionary, except
+// equipment: a route flies any number of aircraft types, so that column
+// holds the codes of row r at values[offsets[r]..offsets[r+1]).
+class RouteColumns {
+public:
+    enum Column { AIRLINE, SOURCE, DEST, SOURCE_COUNTRY, DEST_COUNTRY, CODESHARE, STOPS, EQUIPMENT, COLUMN_COUNT };
+    static constexpr const char* NAMES[COLUMN_COUNT] = {
+        "airline", "source", "dest", "source_country", "dest_country", "codeshare", "stops", "equipment"};
+
+    explicit RouteColumns(const Dataset& data) {
+        for (auto& column : columns_) column.reserve(data.routes.size());
+        equipment_offsets_.reserve(data.routes.size() + 1);
+        equipment_offsets_.push_back(0);
+        auto& countries = data.dicts.countries;
+        for (const auto& route : data.routes) {
+            add(AIRLINE, route.airline_code);
+            add(SOURCE, route.source_airport);
+            add(DEST, route.dest_airport);
+            add(SOURCE_COUNTRY, countries.lookup(route.source_country));
+            add(DEST_COUNTRY, countries.lookup(route.dest_country));
+            add(CODESHARE, route.codeshare);
+            add(STOPS, std::to_string(route.stops));
+            for (const auto& code : equipmentCodes(route.equipment)) add(EQUIPMENT, code);
+            equipment_offsets_.push_back((uint32_t)columns_[EQUIPMENT].size());
+        }
+    }
+
+    static std::optional<Column> parse(const std::string& name) {
+        for (int c = 0; c < COLUMN_COUNT; c++) {
+            if (name == NAMES[c]) return static_cast<Column>(c);
+        }
+        return std::nullopt;
+    }
+
+    static bool multiValued(Column c) { return c == EQUIPMENT; }
+
+    size_t rows() const { return columns_[AIRLINE].size(); }
+    const std::vector<uint16_t>& column(Column c) const { return columns_[c]; }
+    const StringDictionary& dictionary(Column c) const { return dictionaries_[c]; }
+
+    // Codes of a multi-valued column for one row, as [first, last)
+    std::pair<const uint16_t*, const uint16_t*> values(Column c, uint32_t row) const {
+        const uint16_t* codes = columns_[c].data();
+        return {codes + equipment_offsets_[row], codes + equipment_offsets_[row + 1]};
+    }
+
+    // The first column with more distinct values than codes, or null; such
+    // a table can't be queried
+    const char* overflow() const { return overflow_; }
+
+private:
+    void add(Column c, const std::string& value) {
+        uint16_t code;
+        if (!dictionaries_[c].intern(value, code)) {
+            if (!overflow_) overflow_ = NAMES[c];
+            code = 0;
+        }
+        columns_[c].push_back(code);
+    }
+
+    std::vector<uint16_t> columns_[COLUMN_COUNT];
+    std::vector<uint32_t> equipment_offsets_;
+    StringDictionary dictionaries_[COLUMN_COUNT];
+    const char* overflow_ = nullptr;
+};
+
+VersionedCache<RouteColumns> route_columns([](const Dataset& data) { return RouteColumns(data); });
+
+// Group-by over route columns: up to four key columns, each packed into
+// 16 bits of one integer key, and equality filters on any columns. On a
+// multi-valued column a filter matches any of the row's values, and a
+// row counts once in the group of each of its values (in the group of
+// the empty value when it has none).
+struct AggregateQuery {
+    std::vector<RouteColumns::Column> group_by;
+    std::vector<std::pair<RouteColumns::Column, uint16_t>> filters;
+};
+
+struct AggregateGroup {
+    uint64_t key = 0;
+    uint32_t routes = 0;
+    uint32_t codeshares = 0;
+};
+
+// Rows are split into one contiguous partition per core. A partition runs
+// in blocks: each filter narrows a selection vector with a tight loop over
+// one column, then the selected rows are tallied into a thread-local hash
+// table. The tables are merged at the end. `matched` counts the rows that
+// pass the filters.
+std::vector<AggregateGroup> aggregateRoutes(const RouteColumns& table, const AggregateQuery& query,
+                                            uint64_t& matched) {
+    const size_t block_size = 1024;
+    size_t rows = table.rows();
+    size_t n_workers = std::max(1u, std::thread::hardware_concurrency());
+    n_workers = std::max<size_t>(1, std::min(n_workers, rows / (16 * block_size)));
+
+    uint16_t codeshare_yes = 0;
+    bool has_codeshare = table.dictionary(RouteColumns::CODESHARE).find("Y", codeshare_yes);
+    const uint16_t* codeshare = table.column(RouteColumns::CODESHARE).data();
+
+    bool multi_group = false;
+    for (auto column : query.group_by) multi_group |= RouteColumns::multiValued(column);
+
+    using Groups = std::unordered_map<uint64_t, AggregateGroup>;
+    std::vector<Groups> partials(n_workers);
+    std::vector<uint64_t> partial_matched(n_workers, 0);
+    auto scan = [&](size_t worker) {
+        Groups& groups = partials[worker];
+        size_t begin = rows * worker / n_workers;
+        size_t end = rows * (worker + 1) / n_workers;
+        std::vector<uint32_t> selection(block_size);
+        std::vector<uint64_t> keys, expanded;
+        auto tally = [&](uint64_t key, uint32_t row) {
+            AggregateGroup& group = groups[key];
+            group.key = key;
+            group.routes++;
+            group.codeshares += has_codeshare && codeshare[row] == codeshare_yes;
+        };
+        for (size_t base = begin; base < end; base += block_size) {
+            size_t n = std::min(block_size, end - base);
+            size_t selected = n;
+            for (size_t i = 0; i < n; i++) selection[i] = (uint32_t)(base + i);
+            for (const auto& [column, value] : query.filters) {
+                size_t kept = 0;
+                if (RouteColumns::multiValued(column)) {
+                    for (size_t i = 0; i < selected; i++) {
+                        auto [first, last] = table.values(column, selection[i]);
+                        selection[kept] = selection[i];
+                        kept += std::find(first, last, value) != last;
+                    }
+                } else {
+                    const uint16_t* values = table.column(column).data();
+                    for (size_t i = 0; i < selected; i++) {
+                        selection[kept] = selection[i];
+                        kept += values[selection[i]] == value;
+                    }
+                }
+                selected = kept;
+            }
+            partial_matched[worker] += selected;
+            for (size_t i = 0; i < selected; i++) {
+                uint32_t row = selection[i];
+                if (!multi_group) {
+                    uint64_t key = 0;
+                    for (auto column : query.group_by) key = key << 16 | table.column(column)[row];
+                    tally(key, row);
+                    continue;
+                }
+                keys.assign(1, 0);
+                for (auto column : query.group_by) {
+                    if (!RouteColumns::multiValued(column)) {
+                        for (uint64_t& key : keys) key = key << 16 | table.column(column)[row];
+                        continue;
+                    }
+                    auto [first, last] = table.values(column, row);
+                    expanded.clear();
+                    for (uint64_t key : keys) {
+                        if (first == last) expanded.push_back(key << 16);
+                        for (const uint16_t* code = first; code != last; code++) expanded.push_back(key << 16 | *code);
+                    }
+                    keys.swap(expanded);
+                }
+                for (uint64_t key : keys) tally(key, row);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t w = 1; w < n_workers; w++) threads.emplace_back(scan, w);
+    scan(0);
+    for (auto& thread : threads) thread.join();
+
+    matched = 0;
+    for (uint64_t m : partial_matched) matched += m;
+    Groups& merged = partials[0];
+    for (size_t w = 1; w < n_workers; w++) {
+        for (const auto& [key, group] : partials[w]) {
+            AggregateGroup& total = merged[key];
+            total.key = key;
+            total.routes += group.routes;
+            total.codeshares += group.codeshares;
+        }
+    }
+    std::vector<AggregateGroup> result;
+    result.reserve(merged.size());
+    for (const auto& pair : merged) result.push_back(pair.second);
+    return result;
+}
+
+// Compressed set of route rows in the style of a roaring bitmap. Rows are
+// split by their high 16 bits into containers; a container holds a sorted
+// array of low halves while sparse and a 65536-bit bitmap once it passes
+// 4096 rows. Intersection and union go container by container, on whole
+// 64-bit words wherever both sides are bitmaps.
+class RouteBitmap {
+public:
+    // Rows must be added in nondecreasing order
+    void add(uint32_t row) {
+        uint16_t high = row >> 16;
+        if (containers_.empty() || containers_.back().high != high) containers_.emplace_back(high);
+        containers_.back().add(row & 0xffff);
+    }
+
+    size_t cardinality() const {
+        size_t total = 0;
+        for (const auto& container : containers_) total += container.count;
+        return total;
+    }
+
+    // Visit rows in increasing order; f returns false to stop
+    template <typename F>
+    void forEach(F f) const {
+        for (const auto& container : containers_) {
+            uint32_t base = (uint32_t)container.high << 16;
+            if (!container.isBitmap()) {
+                for (uint16_t low : container.array) {
+                    if (!f(base | low)) return;
+                }
+                continue;
+            }
+            for (size_t w = 0; w < WORDS; w++) {
+                for (uint64_t word = container.words[w]; word; word &= word - 1) {
+                    if (!f(base | (uint32_t)(w * 64 + __builtin_ctzll(word)))) return;
+                }
+            }
+        }
+    }
+
+    static RouteBitmap intersect(const RouteBitmap& a, const RouteBitmap& b) {
+        RouteBitmap out;
+        auto i = a.containers_.begin(), j = b.containers_.begin();
+        while (i != a.containers_.end() && j != b.containers_.end()) {
+            if (i->high < j->high) { ++i; continue; }
+            if (j->high < i->high) { ++j; continue; }
+            Container c = Container::intersect(*i++, *j++);
+            if (c.count) out.containers_.push_back(std::move(c));
+        }
+        return out;
+    }
+
+    static RouteBitmap unite(const RouteBitmap& a, const RouteBitmap& b) {
+        RouteBitmap out;
+        auto i = a.containers_.begin(), j = b.containers_.begin();
+        while (i != a.containers_.end() || j != b.containers_.end()) {
+            if (j == b.containers_.end() || (i != a.containers_.end() && i->high < j->high)) {
+                out.containers_.push_back(*i++);
+            } else if (i == a.containers_.end() || j->high < i->high) {
+                out.containers_.push_back(*j++);
+            } else {
+                out.containers_.push_back(Container::unite(*i++, *j++));
+            }
+        }
+        return out;
+    }
+
+private:
+    static constexpr size_t ARRAY_MAX = 4096;
+    static constexpr size_t WORDS = 65536 / 64;
+
+    struct Container {
+        uint16_t high = 0;
+        uint32_t count = 0;
+        std::vector<uint16_t> array;
+        std::vector<uint64_t> words;    // WORDS long in bitmap form, else empty
+
+        explicit Container(uint16_t high) : high(high) {}
+
+        bool isBitmap() const { return !words.empty(); }
+        bool contains(uint16_t low) const {
+            if (isBitmap()) return words[low >> 6] >> (low & 63) & 1;
+            return std::binary_search(array.begin(), array.end(), low);
+        }
+
+        void add(uint16_t low) {
+            if (isBitmap()) {
+                count += !(words[low >> 6] >> (low & 63) & 1);
+                words[low >> 6] |= uint64_t(1) << (low & 63);
+                return;
+            }
+            if (!array.empty() && array.back() == low) return;
+            array.push_back(low);
+            count++;
+            if (array.size() > ARRAY_MAX) toBitmap();
+        }
+
+        void toBitmap() {
+            words.assign(WORDS, 0);
+            for (uint16_t low : array) words[low >> 6] |= uint64_t(1) << (low & 63);
+            array.clear();
+            array.shrink_to_fit();
+        }
+
+        // Back to array form when a bitmap result turns out sparse
+        void recount() {
+            count = 0;
+            for (uint64_t word : words) count += __builtin_popcountll(word);
+            if (count > ARRAY_MAX) return;
+            for (size_t w = 0; w < WORDS; w++) {
+                for (uint64_t word = words[w]; word; word &= word - 1)
+                    array.push_back((uint16_t)(w * 64 + __builtin_ctzll(word)));
+            }
+            words.clear();
+        }
+
+        static Container intersect(const Container& a, const Container& b) {
+            Container out(a.high);
+            if (a.isBitmap() && b.isBitmap()) {
+                out.words.resize(WORDS);
+                for (size_t w = 0; w < WORDS; w++) out.words[w] = a.words[w] & b.words[w];
+                out.recount();
+                return out;
+            }
+            if (a.isBitmap() || b.isBitmap()) {
+                const Container& sparse = a.isBitmap() ? b : a;
+                const Container& dense = a.isBitmap() ? a : b;
+                for (uint16_t low : sparse.array) {
+                    if (dense.contains(low)) out.array.push_back(low);
+                }
+            } else {
+                std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                                      std::back_inserter(out.array));
+            }
+            out.count = (uint32_t)out.array.size();
+            return out;
+        }
+
+        static Container unite(const Container& a, const Container& b) {
+            Container out(a.high);
+            if (a.isBitmap() || b.isBitmap()) {
+                out.words.assign(WORDS, 0);
+                for (const Container* c : {&a, &b}) {
+                    if (c->isBitmap()) {
+                        for (size_t w = 0; w < WORDS; w++) out.words[w] |= c->words[w];
+                    } else {
+                        for (uint16_t low : c->array) out.words[low >> 6] |= uint64_t(1) << (low & 63);
+                    }
+                }
+                out.recount();
+                return out;
+            }
+            std::set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                           std::back_inserter(out.array));
+            out.count = (uint32_t)out.array.size();
+            if (out.array.size() > ARRAY_MAX) out.toBitmap();
+            return out;
+        }
+    };
+
+    std::vector<Container> containers_;
+};
+
+// Route rows by airline code, source and destination country, equipment
+// code, codeshare flag (Y or N) and stop count, one bitmap per value.
+// Rows are positions in Dataset::routes for the version the index was
+// built from.
+class RouteBitmapIndex {
+public:
+    enum Field { AIRLINE, SOURCE_COUNTRY, DEST_COUNTRY, EQUIPMENT, CODESHARE, STOPS, FIELD_COUNT };
+    static constexpr const char* NAMES[FIELD_COUNT] = {
+        "airline", "source_country", "dest_country", "equipment", "codeshare", "stops"};
+
+    explicit RouteBitmapIndex(const Dataset& data) {
+        auto& countries = data.dicts.countries;
+        for (uint32_t row = 0; row < data.routes.size(); row++) {
+            const Route& route = data.routes[row];
+            bitmaps_[AIRLINE][route.airline_code].add(row);
+            bitmaps_[SOURCE_COUNTRY][countries.lookup(route.source_country)].add(row);
+            bitmaps_[DEST_COUNTRY][countries.lookup(route.dest_country)].add(row);
+            bitmaps_[CODESHARE][route.codeshare == "Y" ? "Y" : "N"].add(row);
+            bitmaps_[STOPS][std::to_string(route.stops)].add(row);
+            std::stringstream equipment(route.equipment);
+            std::string code;
+            while (equipment >> code) bitmaps_[EQUIPMENT][code].add(row);
+        }
+    }
+
+    // Rows with any of the values for a field
+    RouteBitmap any(Field field, const std::vector<std::string>& values) const {
+        RouteBitmap rows;
+        for (const auto& value : values) {
+            auto it = bitmaps_[field].find(value);
+            if (it != bitmaps_[field].end()) rows = RouteBitmap::unite(rows, it->second);
+        }
+        return rows;
+    }
+
+private:
+    std::unordered_map<std::string, RouteBitmap> bitmaps_[FIELD_COUNT];
+};
+
+VersionedCache<RouteBitmapIndex> route_bitmaps([](const Dataset& data) { return RouteBitmapIndex(data); });
+
+// Route equipment as a multi-value column. The aircraft type codes of row
+// r are codes[offsets[r]..offsets[r+1]), coded through one dictionary, so
+// the space-separated string is split once per dataset version. Alongside
+// it are the rows flown by each type, in the same offsets-and-values form,
+// and the type mix of each airline.
+class EquipmentIndex {
+public:
+    struct Mix {
+        uint16_t code;
+        uint32_t routes;
+    };
+
+    explicit EquipmentIndex(const Dataset& data) {
+        offsets_.reserve(data.routes.size() + 1);
+        offsets_.push_back(0);
+        for (const auto& route : data.routes) {
+            for (const auto& code : equipmentCodes(route.equipment)) {
+                uint16_t coded;
+                if (dictionary_.intern(code, coded)) codes_.push_back(coded);
+                else full_ = true;
+            }
+            offsets_.push_back(static_cast<uint32_t>(codes_.size()));
+        }
+
+        // Rows per type: count, prefix-sum, then fill in row order
+        row_offsets_.assign(dictionary_.size() + 1, 0);
+        for (uint16_t code : codes_) row_offsets_[code + 1]++;
+        for (size_t c = 1; c < row_offsets_.size(); c++) row_offsets_[c] += row_offsets_[c - 1];
+        rows_.resize(codes_.size());
+        std::vector<uint32_t> next(row_offsets_.begin(), row_offsets_.end() - 1);
+        for (uint32_t row = 0; row + 1 < offsets_.size(); row++) {
+            for (uint16_t code : codesOf(row)) rows_[next[code]++] = row;
+        }
+
+        std::unordered_map<std::string, std::unordered_map<uint16_t, uint32_t>> tallies;
+        for (uint32_t row = 0; row < data.routes.size(); row++) {
+            auto& airline = tallies[data.routes[row].airline_code];
+            for (uint16_t code : codesOf(row)) airline[code]++;
+        }
+        for (auto& [airline, counts] : tallies) mixes_[airline] = sortedMix(counts);
+        std::unordered_map<uint16_t, uint32_t> all;
+        for (size_t c = 1; c < dictionary_.size(); c++) all[(uint16_t)c] = row_offsets_[c + 1] - row_offsets_[c];
+        overall_ = sortedMix(all);
+    }
+
+    struct Span {
+        const uint32_t* first;
+        const uint32_t* last;
+        const uint32_t* begin() const { return first; }
+        const uint32_t* end() const { return last; }
+        size_t size() const { return last - first; }
+    };
+
+    struct CodeSpan {
+        const uint16_t* first;
+        const uint16_t* last;
+        const uint16_t* begin() const { return first; }
+        const uint16_t* end() const { return last; }
+    };
+
+    CodeSpan codesOf(uint32_t row) const {
+        return {codes_.data() + offsets_[row], codes_.data() + offsets_[row + 1]};
+    }
+
+    // Rows flown with a type, in row order
+    Span rowsOf(const std::string& code) const {
+        uint16_t coded;
+        if (code.empty() || !dictionary_.find(code, coded)) return {nullptr, nullptr};
+        return {rows_.data() + row_offsets_[coded], rows_.data() + row_offsets_[coded + 1]};
+    }
+
+    // Types flown by an airline, most routes first; null for no routes
+    const std::vector<Mix>* mixOf(const std::string& airline) const {
+        auto it = mixes_.find(airline);
+        return it == mixes_.end() ? nullptr : &it->second;
+    }
+
+    const std::vector<Mix>& overall() const { return overall_; }
+    const std::string& name(uint16_t code) const { return dictionary_.lookup(code); }
+
+    // Whether some types didn't fit the dictionary and were left out
+    bool full() const { return full_; }
+
+private:
+    std::vector<Mix> sortedMix(const std::unordered_map<uint16_t, uint32_t>& counts) const {
+        std::vector<Mix> mix;
+        for (const auto& [code, routes] : counts) mix.push_back({code, routes});
+        std::sort(mix.begin(), mix.end(), [&](const Mix& a, const Mix& b) {
+            return a.routes != b.routes ? a.routes > b.routes : name(a.code) < name(b.code);
+        });
+        return mix;
+    }
+
+    StringDictionary dictionary_;
+    std::vector<uint32_t> offsets_;
+    std::vector<uint16_t> codes_;
+    std::vector<uint32_t> row_offsets_;
+    std::vector<uint32_t> rows_;
+    std::unordered_map<std::string, std::vector<Mix>> mixes_;
+    std::vector<Mix> overall_;
+    bool full_ = false;
+};
+
+VersionedCache<EquipmentIndex> equipment_index([](const Dataset& data) { return EquipmentIndex(data); });
+
+// Render the one-hop results page for two normalized IATA codes
+std::string renderOneHopPage(const std::string& source, const std::string& dest) {
+    std::shared_lock<std::shared_mutex> lock(session_mutex);
+    auto codes = airline_codes.get(session, session_version.load());
+
+    std::string html = htmlHeader();
+    html += R"(<h2>🔄 One-Hop Route Results</h2>)";
+
+    const Airport* source_airport = session.airportByIata(source);
+    const Airport* dest_airport = session.airportByIata(dest);
+    
+    if (source_airport && dest_airport) {
+        
+        // Find one-hop routes
+        struct RouteInfo {
+            std::string intermediate;
+            std::string airline1;
+            std::string airline2;
+            double distance;
+        };
+        
+        std::vector<RouteInfo> one_hop_routes;
+        
+        // Find routes from source
+        std::set<std::string> intermediates;
+        for (const auto& route : session.routes) {
+            if (route.source_airport == source && route.stops == 0) {
+                intermediates.insert(route.dest_airport);
+            }
+        }
+        
+        // Find routes from intermediates to destination
+        for (const auto& intermediate : intermediates) {
+            for (const auto& route : session.routes) {
+                if (route.source_airport == intermediate && 
+                    route.dest_airport == dest && 
+                    route.stops == 0) {
+                    
+                    // Find airline names
+                    std::string airline1 = "Unknown";
+                    std::string airline2 = "Unknown";
+                    
+                    for (const auto& r1 : session.routes) {
+                        if (r1.source_airport == source && r1.dest_airport == intermediate) {
+                            if (const Airline* a = codes->primary(session, r1.airline_code)) {
+                                airline1 = a->name;
+                            }
+                            break;
+                        }
+                    }
+                    
+                    if (const Airline* a = codes->primary(session, route.airline_code)) {
+                        airline2 = a->name;
+                    }
+                    
+                    // Calculate distance
+                    if (const Airport* inter_airport = session.airportByIata(intermediate)) {
+                        double dist1 = calculateDistance(
+                            source_airport->latitude, source_airport->longitude,
+                            inter_airport->latitude, inter_airport->longitude
+                        );
+                        double dist2 = calculateDistance(
+                            inter_airport->latitude, inter_airport->longitude,
+                            dest_airport->latitude, dest_airport->longitude
+                        );
+                        
+                        RouteInfo info;
+                        info.intermediate = intermediate;
+                        info.airline1 = airline1;
+                        info.airline2 = airline2;
+                        info.distance = dist1 + dist2;
+                        one_hop_routes.push_back(info);
+                    }
+                }
+            }
+        }
+        
+        // Sort by distance
+        std::sort(one_hop_routes.begin(), one_hop_routes.end(),
+            [](const RouteInfo& a, const RouteInfo& b) {
+                return a.distance < b.distance;
+            });
+        
+        if (!one_hop_routes.empty()) {
+            html += "<div class='result-box'>";
+            html += "<h3>Found " + std::to_string(one_hop_routes.size()) + " one-hop route(s)</h3>";
+            html += "<table><thead><tr>";
+            html += "<th>Rank</th><th>Route</th><th>Airlines</th><th>Total Distance (miles)</th>";
+            html += "</tr></thead><tbody>";
+            
+            int rank = 1;
+            for (const auto& route_info : one_hop_routes) {
+                html += "<tr>";
+                html += "<td>" + std::to_string(rank++) + "</td>";
+                html += "<td>" + source + " → " + route_info.intermediate + " → " + dest + "</td>";
+                html += "<td>" + route_info.airline1 + " / " + route_info.airline2 + "</td>";
+                html += "<td>" + std::to_string(static_cast<int>(route_info.distance)) + "</td>";
+                html += "</tr>";
+            }
+            
+            html += "</tbody></table></div>";
+        } else {
+            html += "<div class='result-box' style='border-left-color: #ffc107;'>";
+            html += "<p>⚠️ No one-hop routes found between " + source + " and " + dest + "</p>";
+            html += "</div>";
+        }
+    } else {
+        html += "<div class='result-box' style='border-left-color: #dc3545;'>";
+        html += "<p>❌ One or both airports not found.</p>";
+        html += "</div>";
+    }
+
+    html += "<p><a href='/onehop' class='btn'>🔙 Search Again</a></p>";
+    html += htmlFooter();
+    return html;
+}
+
+// Run work(i) for every task index on all cores. Each worker owns a deque
+// seeded round-robin; it pops from the back of its own and, once that is
+// empty, steals from the front of another worker's.
+template <typename F>
+void runWorkStealing(size_t n_tasks, F work) {
+    size_t n_workers = std::max(1u, std::thread::hardware_concurrency());
+    n_workers = std::max<size_t>(1, std::min(n_workers, n_tasks));
+
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+    std::vector<TaskQueue> queues(n_workers);
+    for (size_t i = 0; i < n_tasks; i++) queues[i % n_workers].tasks.push_back(i);
+
+    auto worker = [&](size_t self) {
+        while (true) {
+            std::optional<size_t> task;
+            for (size_t k = 0; k < n_workers && !task; k++) {
+                TaskQueue& queue = queues[(self + k) % n_workers];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (queue.tasks.empty()) continue;
+                if (k == 0) {
+                    task = queue.tasks.back();
+                    queue.tasks.pop_back();
+                } else {
+                    task = queue.tasks.front();
+                    queue.tasks.pop_front();
+                }
+            }
+            if (!task) return;     // nothing is ever re-queued, so all done
+            work(*task);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t w = 1; w < n_workers; w++) threads.emplace_back(worker, w);
+    worker(0);
+    for (auto& t : threads) t.join();
+}
+
+// One origin/destination pair of a batch, or the reason its line was bad
+struct OdPair {
+    size_t line;
+    std::string source;
+    std::string dest;
+    std::string error;
+};
+
+// One "SRC,DST" pair per line; blank lines are skipped
+std::vector<OdPair> parseOdPairs(const std::string& text) {
+    std::vector<OdPair> pairs;
+    std::istringstream in(text);
+    std::string line;
+    size_t line_no = 0;
+    while (std::getline(in, line)) {
+        line_no++;
+        if (trim(line).empty()) continue;
+        auto fields = parseCSVLine(line);
+        if (fields.size() != 2 || fields[0].empty() || fields[1].empty()) {
+            pairs.push_back({line_no, "", "", "expected SRC,DST"});
+            continue;
+        }
+        pairs.push_back({line_no, upperCase(fields[0]), upperCase(fields[1]), ""});
+    }
+    return pairs;
+}
+
+// Route tables the one-hop solver reads: the nonstop destinations of each
+// airport, the airline of the first route for each airport pair, and the
+// airlines of each nonstop leg, both in route order as the single search
+// sees them
+struct OneHopTables {
+    std::unordered_map<std::string, std::set<std::string>> nonstop_from;
+    std::unordered_map<std::string, std::string> first_airline;
+    std::unordered_map<std::string, std::vector<std::string>> nonstop_airlines;
+
+    explicit OneHopTables(const Dataset& data) {
+        AirlineCodeIndex codes(data);
+        for (const auto& route : data.routes) {
+            std::string leg = route.source_airport + "|" + route.dest_airport;
+            const Airline* airline = codes.primary(data, route.airline_code);
+            std::string name = airline ? airline->name : "Unknown";
+            first_airline.emplace(leg, name);
+            if (route.stops == 0) {
+                nonstop_from[route.source_airport].insert(route.dest_airport);
+                nonstop_airlines[leg].push_back(name);
+            }
+        }
+    }
+};
+
+VersionedCache<OneHopTables> onehop_tables([](const Dataset& data) { return OneHopTables(data); });
+
+// A batch of pairs grouped by origin, so each origin's outgoing expansion
+// is done once. Malformed lines are answered up front, in `errors`.
+struct OneHopPlan {
+    std::vector<OdPair> pairs;
+    std::string errors;
+    std::vector<std::vector<size_t>> groups;
+};
+
+OneHopPlan planOneHopBatch(std::vector<OdPair> pairs) {
+    OneHopPlan plan;
+    plan.pairs = std::move(pairs);
+    std::unordered_map<std::string, std::vector<size_t>> by_origin;
+    for (size_t i = 0; i < plan.pairs.size(); i++) {
+        const OdPair& pair = plan.pairs[i];
+        if (!pair.error.empty()) {
+            crow::json::wvalue line;
+            line["line"] = pair.line;
+            line["error"] = pair.error;
+            plan.errors += line.dump() + "\n";
+            continue;
+        }
+        by_origin[pair.source].push_back(i);
+    }
+    for (auto& entry : by_origin) plan.groups.push_back(std::move(entry.second));
+    // Biggest groups first, so the stragglers at the end of a run are small
+    std::sort(plan.groups.begin(), plan.groups.end(),
+              [](const auto& a, const auto& b) { return a.size() > b.size(); });
+    return plan;
+}
+
+// NDJSON lines for groups [first, last) of a plan, with the same results
+// as /onehop/search. The groups run on a work-stealing pool; their lines
+// come back in group order.
+std::string solveOneHopGroups(const Dataset& data, const OneHopTables& tables, const OneHopPlan& plan,
+                              size_t first, size_t last) {
+    static const std::set<std::string> no_intermediates;
+    std::vector<std::string> group_lines(last - first);
+    runWorkStealing(last - first, [&](size_t k) {
+        const auto& group = plan.groups[first + k];
+        const std::string& source = plan.pairs[group[0]].source;
+        const Airport* source_airport = data.airportByIata(source);
+        auto out_it = tables.nonstop_from.find(source);
+        const auto& intermediates = out_it == tables.nonstop_from.end() ? no_intermediates : out_it->second;
+
+        struct Connection {
+            std::string via;
+            const std::string* airline1;
+            const std::string* airline2;
+            double distance;
+        };
+
+        std::string& lines = group_lines[k];
+        for (size_t index : group) {
+            const std::string& dest = plan.pairs[index].dest;
+            const Airport* dest_airport = data.airportByIata(dest);
+
+            crow::json::wvalue line;
+            line["source"] = source;
+            line["dest"] = dest;
+            line["found"] = source_airport && dest_airport;
+            line["routes"] = crow::json::wvalue::list();
+            if (source_airport && dest_airport) {
+                std::vector<Connection> connections;
+                for (const auto& via : intermediates) {
+                    auto legs = tables.nonstop_airlines.find(via + "|" + dest);
+                    const Airport* via_airport =
+                        legs == tables.nonstop_airlines.end() ? nullptr : data.airportByIata(via);
+                    if (!via_airport) continue;
+                    const std::string& airline1 = tables.first_airline.at(source + "|" + via);
+                    double distance =
+                        calculateDistance(source_airport->latitude, source_airport->longitude,
+                                          via_airport->latitude, via_airport->longitude) +
+                        calculateDistance(via_airport->latitude, via_airport->longitude,
+                                          dest_airport->latitude, dest_airport->longitude);
+                    for (const auto& airline2 : legs->second)
+                        connections.push_back({via, &airline1, &airline2, distance});
+                }
+                std::stable_sort(connections.begin(), connections.end(),
+                    [](const Connection& a, const Connection& b) { return a.distance < b.distance; });
+
+                for (size_t i = 0; i < connections.size(); i++) {
+                    auto& item = line["routes"][i];
+                    item["via"] = connections[i].via;
+                    item["airline1"] = *connections[i].airline1;
+                    item["airline2"] = *connections[i].airline2;
+                    item["distance"] = static_cast<int>(connections[i].distance);
+                }
+            }
+            lines += line.dump() + "\n";
+        }
+    });
+
+    std::string out;
+    for (const auto& lines : group_lines) out += lines;
+    return out;
+}
+
+// Where the next chunk of a batch ends: whole groups, about
+// pairs_per_chunk pairs at a time
+size_t nextOneHopChunk(const OneHopPlan& plan, size_t first) {
+    const size_t pairs_per_chunk = 2048;
+    size_t last = first, pairs = 0;
+    while (last < plan.groups.size() && pairs < pairs_per_chunk) pairs += plan.groups[last++].size();
+    return last;
+}
+
+// Solve a whole batch, handing emit() the NDJSON one chunk at a time
+void solveOneHopBatch(const Dataset& data, const std::vector<OdPair>& pairs,
+                      const std::function<void(const std::string&)>& emit) {
+    OneHopTables tables(data);
+    OneHopPlan plan = planOneHopBatch(pairs);
+    if (!plan.errors.empty()) emit(plan.errors);
+    for (size_t first = 0; first < plan.groups.size();) {
+        size_t last = nextOneHopChunk(plan, first);
+        emit(solveOneHopGroups(data, tables, plan, first, last));
+        first = last;
+    }
+}
+
+// Body producer for /api/v1/onehop:batch: the malformed lines, then the
+// groups a chunk at a time. Each chunk takes the session lock afresh, so
+// writers aren't held off for the whole batch or while the client reads.
+std::function<bool(std::string&)> streamOneHopBatch(std::shared_ptr<const OneHopPlan> plan) {
+    struct State {
+        bool errors_sent = false;
+        size_t next = 0;
+    };
+    auto state = std::make_shared<State>();
+
+    return [=](std::string& chunk) {
+        if (!state->errors_sent) {
+            chunk = plan->errors;
+            state->errors_sent = true;
+            return !plan->groups.empty();
+        }
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        auto tables = onehop_tables.get(session, session_version.load());
+        size_t last = nextOneHopChunk(*plan, state->next);
+        chunk = solveOneHopGroups(session, *tables, *plan, state->next, last);
+        state->next = last;
+        return last < plan->groups.size();
+    };
+}
+
+// The route network as a compact directed graph: one vertex per airport
+// code that appears in a route, in code order, and one edge per distinct
+// source and destination. A vertex's out-edges are
+// targets[offsets[v]..offsets[v+1]).
+struct RouteGraph {
+    std::vector<std::string> codes;
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> targets;
+
+    size_t size() const { return codes.size(); }
+};
+
+RouteGraph buildRouteGraph(const Dataset& data) {
+    RouteGraph graph;
+    std::set<std::string> codes;
+    for (const auto& route : data.routes) {
+        codes.insert(route.source_airport);
+        codes.insert(route.dest_airport);
+    }
+    graph.codes.assign(codes.begin(), codes.end());
+    for (uint32_t v = 0; v < graph.codes.size(); v++) graph.ids[graph.codes[v]] = v;
+
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    edges.reserve(data.routes.size());
+    for (const auto& route : data.routes) {
+        uint32_t source = graph.ids[route.source_airport], dest = graph.ids[route.dest_airport];
+        if (source != dest) edges.push_back({source, dest});
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    graph.offsets.assign(graph.size() + 1, 0);
+    for (const auto& edge : edges) graph.offsets[edge.first + 1]++;
+    for (size_t v = 1; v <= graph.size(); v++) graph.offsets[v] += graph.offsets[v - 1];
+    for (const auto& edge : edges) graph.targets.push_back(edge.second);
+    return graph;
+}
+
+VersionedCache<RouteGraph> route_graph(buildRouteGraph);
+
+// Betweenness and closeness of every vertex of one route graph version.
+// Betweenness is normalized by (n-1)(n-2); closeness is the Wasserman-Faust
+// form, which scales by the share of airports a source can reach.
+struct Centrality {
+    uint64_t version = 0;
+    std::shared_ptr<const RouteGraph> graph;
+    std::vector<double> betweenness;
+    std::vector<double> closeness;
+    long long elapsed_ms = 0;
+};
+
+// Brandes' algorithm with one BFS per source, sources split into blocks
+// run on all cores. Each block accumulates dependencies privately and adds
+// them in once; done counts finished sources for progress reports.
+Centrality computeCentrality(const RouteGraph& graph, std::atomic<size_t>& done) {
+    const size_t block_size = 32;
+    size_t n = graph.size();
+    Centrality result;
+    result.betweenness.assign(n, 0);
+    result.closeness.assign(n, 0);
+    std::mutex merge_mutex;
+
+    runWorkStealing((n + block_size - 1) / block_size, [&](size_t block) {
+        std::vector<int32_t> dist(n, -1);
+        std::vector<double> sigma(n, 0), delta(n, 0), dependency(n, 0);
+        std::vector<uint32_t> order;
+        order.reserve(n);
+
+        for (size_t s = block * block_size; s < std::min(n, (block + 1) * block_size); s++) {
+            order.clear();
+            dist[s] = 0;
+            sigma[s] = 1;
+            order.push_back((uint32_t)s);
+            uint64_t total_dist = 0;
+            for (size_t head = 0; head < order.size(); head++) {
+                uint32_t v = order[head];
+                for (uint32_t e = graph.offsets[v]; e < graph.offsets[v + 1]; e++) {
+                    uint32_t w = graph.targets[e];
+                    if (dist[w] < 0) {
+                        dist[w] = dist[v] + 1;
+                        total_dist += dist[w];
+                        order.push_back(w);
+                    }
+                    if (dist[w] == dist[v] + 1) sigma[w] += sigma[v];
+                }
+            }
+
+            // Vertices in reverse BFS order, so every successor on a
+            // shortest path is final before its predecessors read it
+            for (size_t i = order.size(); i-- > 0;) {
+                uint32_t v = order[i];
+                for (uint32_t e = graph.offsets[v]; e < graph.offsets[v + 1]; e++) {
+                    uint32_t w = graph.targets[e];
+                    if (dist[w] == dist[v] + 1) delta[v] += sigma[v] / sigma[w] * (1 + delta[w]);
+                }
+                if (v != s) dependency[v] += delta[v];
+            }
+
+            size_t reached = order.size() - 1;
+            if (reached > 0 && n > 1)
+                result.closeness[s] = (double)reached / (n - 1) * reached / total_dist;
+            for (uint32_t v : order) {
+                dist[v] = -1;
+                sigma[v] = 0;
+                delta[v] = 0;
+            }
+            done++;
+        }
+
+        std::lock_guard<std::mutex> lock(merge_mutex);
+        for (size_t v = 0; v < n; v++) result.betweenness[v] += dependency[v];
+    });
+
+    if (n > 2) {
+        for (double& b : result.betweenness) b /= (double)(n - 1) * (n - 2);
+    }
+    return result;
+}
+
+// Background centrality job: one run at a time over a snapshot of the
+// route graph. The latest finished result is served while its data
+// version is current.
+std::atomic<bool> centrality_running{false};
+std::atomic<size_t> centrality_done{0};
+std::atomic<size_t> centrality_total{0};
+std::mutex centrality_mutex;
+std::shared_ptr<const Centrality> centrality_result;
+
+// Start a background run; false if one is already running
+bool startCentrality() {
+    bool expected = false;
+    if (!centrality_running.compare_exchange_strong(expected, true))
+        return false;
+
+    uint64_t version;
+    std::shared_ptr<const RouteGraph> graph;
+    {
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        version = session_version.load();
+        graph = route_graph.get(session, version);
+    }
+    centrality_done = 0;
+    centrality_total = graph->size();
+
+    std::thread([graph, version] {
+        auto start = std::chrono::steady_clock::now();
+        auto result = std::make_shared<Centrality>(computeCentrality(*graph, centrality_done));
+        result->version = version;
+        result->graph = graph;
+        result->elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        {
+            std::lock_guard<std::mutex> lock(centrality_mutex);
+            centrality_result = result;
+        }
+        centrality_running = false;
+    }).detach();
+    return true;
+}
+
+// Progress of the centrality job and the version of its latest result
+crow::json::wvalue centralityStatus() {
+    crow::json::wvalue status;
+    bool running = centrality_running.load();
+    size_t done = centrality_done.load(), total = centrality_total.load();
+    status["running"] = running;
+    status["sources_done"] = done;
+    status["sources_total"] = total;
+    status["progress"] = total ? (double)done / total : (running ? 0.0 : 1.0);
+    std::lock_guard<std::mutex> lock(centrality_mutex);
+    if (centrality_result) {
+        status["result_version"] = centrality_result->version;
+        status["elapsed_ms"] = centrality_result->elapsed_ms;
+    }
+    return status;
+}
+
+// Weak and strong components of one route graph version. Strong
+// components come from an iterative Tarjan, numbered in completion order,
+// which puts every component after all the ones it reaches. Each strong
+// component has a bitset of the components it reaches in the condensation,
+// so directed reachability is one bit test.
+class ConnectivityIndex {
+public:
+    explicit ConnectivityIndex(const Dataset& data) : graph_(buildRouteGraph(data)) {
+        size_t n = graph_.size();
+        DisjointSets weak;
+        for (size_t v = 0; v < n; v++) weak.add();
+        for (uint32_t v = 0; v < n; v++) {
+            for (uint32_t e = graph_.offsets[v]; e < graph_.offsets[v + 1]; e++) weak.unite(v, graph_.targets[e]);
+        }
+        weak_root_.resize(n);
+        weak_size_.resize(n);
+        for (uint32_t v = 0; v < n; v++) {
+            weak_root_[v] = weak.find(v);
+            weak_size_[v] = weak.sizeOf(v);
+        }
+        weak_count_ = weak.sets();
+
+        findStrongComponents();
+
+        size_t s = strong_size_.size();
+        words_ = (s + 63) / 64;
+        reach_.assign(s * words_, 0);
+        for (uint32_t c = 0; c < s; c++) {
+            uint64_t* row = &reach_[c * words_];
+            row[c / 64] |= uint64_t(1) << (c % 64);
+            for (uint32_t v : members_[c]) {
+                for (uint32_t e = graph_.offsets[v]; e < graph_.offsets[v + 1]; e++) {
+                    uint32_t d = strong_[graph_.targets[e]];
+                    if (d == c) continue;
+                    const uint64_t* other = &reach_[d * words_];
+                    for (size_t w = 0; w < words_; w++) row[w] |= other[w];
+                }
+            }
+        }
+        reach_airports_.assign(s, 0);
+        for (uint32_t c = 0; c < s; c++) {
+            for (uint32_t d = 0; d < s; d++) {
+                if (reach_[c * words_ + d / 64] >> (d % 64) & 1) reach_airports_[c] += strong_size_[d];
+            }
+        }
+    }
+
+    std::optional<uint32_t> vertexOf(const std::string& iata) const {
+        auto it = graph_.ids.find(iata);
+        if (it == graph_.ids.end()) return std::nullopt;
+        return it->second;
+    }
+
+    bool reaches(uint32_t from, uint32_t to) const {
+        uint32_t d = strong_[to];
+        return reach_[strong_[from] * words_ + d / 64] >> (d % 64) & 1;
+    }
+
+    uint32_t weakRoot(uint32_t v) const { return weak_root_[v]; }
+    uint32_t weakSize(uint32_t v) const { return weak_size_[v]; }
+    uint32_t strongComponent(uint32_t v) const { return strong_[v]; }
+    uint32_t strongSize(uint32_t v) const { return strong_size_[strong_[v]]; }
+
+    // Airports reachable from v, not counting v itself
+    uint32_t reachableFrom(uint32_t v) const { return reach_airports_[strong_[v]] - 1; }
+
+    size_t weakComponents() const { return weak_count_; }
+    size_t strongComponents() const { return strong_size_.size(); }
+    uint32_t largestWeak() const { return weak_size_.empty() ? 0 : *std::max_element(weak_size_.begin(), weak_size_.end()); }
+    uint32_t largestStrong() const {
+        return strong_size_.empty() ? 0 : *std::max_element(strong_size_.begin(), strong_size_.end());
+    }
+
+private:
+    void findStrongComponents() {
+        size_t n = graph_.size();
+        const int32_t UNSEEN = -1;
+        std::vector<int32_t> index(n, UNSEEN), low(n, 0);
+        std::vector<bool> on_stack(n, false);
+        std::vector<uint32_t> stack;
+        std::vector<std::pair<uint32_t, uint32_t>> frames;     // vertex, next edge
+        strong_.assign(n, 0);
+        int32_t counter = 0;
+
+        for (uint32_t root = 0; root < n; root++) {
+            if (index[root] != UNSEEN) continue;
+            auto visit = [&](uint32_t v) {
+                index[v] = low[v] = counter++;
+                stack.push_back(v);
+                on_stack[v] = true;
+                frames.push_back({v, graph_.offsets[v]});
+            };
+            visit(root);
+            while (!frames.empty()) {
+                uint32_t v = frames.back().first;
+                uint32_t& e = frames.back().second;
+                if (e < graph_.offsets[v + 1]) {
+                    uint32_t w = graph_.targets[e++];
+                    if (index[w] == UNSEEN) visit(w);
+                    else if (on_stack[w]) low[v] = std::min(low[v], index[w]);
+                    continue;
+                }
+                if (low[v] == index[v]) {
+                    uint32_t c = (uint32_t)strong_size_.size();
+                    members_.emplace_back();
+                    uint32_t w;
+                    do {
+                        w = stack.back();
+                        stack.pop_back();
+                        on_stack[w] = false;
+                        strong_[w] = c;
+                        members_[c].push_back(w);
+                    } while (w != v);
+                    strong_size_.push_back((uint32_t)members_[c].size());
+                }
+                frames.pop_back();
+                if (!frames.empty()) {
+                    uint32_t parent = frames.back().first;
+                    low[parent] = std::min(low[parent], low[v]);
+                }
+            }
+        }
+    }
+
+    RouteGraph graph_;
+    std::vector<uint32_t> weak_root_;
+    std::vector<uint32_t> weak_size_;
+    size_t weak_count_ = 0;
+    std::vector<uint32_t> strong_;              // component of each vertex
+    std::vector<uint32_t> strong_size_;
+    std::vector<std::vector<uint32_t>> members_;
+    size_t words_ = 0;
+    std::vector<uint64_t> reach_;               // words_ per component
+    std::vector<uint32_t> reach_airports_;
+};
+
+VersionedCache<ConnectivityIndex> connectivity([](const Dataset& data) { return ConnectivityIndex(data); });
+
+// Minimum flight count between every pair of route graph vertices, four
+// bits a pair: 0-13 hops exactly, BEYOND for a path of 14 or more, and
+// UNREACHABLE for no path at all. Rows belong to sources and are padded
+// to whole bytes, so a lookup is one byte read and each row is written by
+// one thread.
+//
+// Built by bit-parallel multi-source BFS: 64 sources share a pass, each
+// vertex holding a 64-bit word of the sources that have reached it, so a
+// level is one sweep of OR operations over the edges. A pass runs until
+// its frontier is empty, so every pair it doesn't reach is unreachable.
+// Batches of 64 sources run on all cores.
+class HopMatrix {
+public:
+    static constexpr uint8_t BEYOND = 14;
+    static constexpr uint8_t UNREACHABLE = 15;
+
+    explicit HopMatrix(const Dataset& data) : graph_(buildRouteGraph(data)) {
+        size_t n = graph_.size();
+        row_bytes_ = (n + 1) / 2;
+        cells_.assign(n * row_bytes_, UNREACHABLE << 4 | UNREACHABLE);
+
+        runWorkStealing((n + 63) / 64, [&](size_t batch) {
+            size_t first = batch * 64, count = std::min<size_t>(64, n - first);
+            std::vector<uint64_t> seen(n, 0), frontier(n, 0), next(n, 0);
+            for (size_t i = 0; i < count; i++) {
+                seen[first + i] = frontier[first + i] = uint64_t(1) << i;
+                set(first + i, first + i, 0);
+            }
+            for (size_t level = 1;; level++) {
+                uint8_t hops = (uint8_t)std::min<size_t>(level, BEYOND);
+                bool any = false;
+                for (uint32_t v = 0; v < n; v++) {
+                    if (!frontier[v]) continue;
+                    for (uint32_t e = graph_.offsets[v]; e < graph_.offsets[v + 1]; e++)
+                        next[graph_.targets[e]] |= frontier[v];
+                }
+                for (uint32_t w = 0; w < n; w++) {
+                    uint64_t fresh = next[w] & ~seen[w];
+                    next[w] = 0;
+                    frontier[w] = fresh;
+                    if (!fresh) continue;
+                    any = true;
+                    seen[w] |= fresh;
+                    for (; fresh; fresh &= fresh - 1) set(first + __builtin_ctzll(fresh), w, hops);
+                }
+                if (!any) break;
+            }
+        });
+    }
+
+    std::optional<uint32_t> vertexOf(const std::string& iata) const {
+        auto it = graph_.ids.find(iata);
+        if (it == graph_.ids.end()) return std::nullopt;
+        return it->second;
+    }
+
+    uint8_t hops(uint32_t from, uint32_t to) const {
+        return cells_[from * row_bytes_ + to / 2] >> (to % 2 * 4) & 0xf;
+    }
+
+    // Exact hop count for a BEYOND pair, by a plain BFS; -1 if none
+    int farHops(uint32_t from, uint32_t to) const {
+        std::vector<int> dist(graph_.size(), -1);
+        std::vector<uint32_t> queue{from};
+        dist[from] = 0;
+        for (size_t head = 0; head < queue.size(); head++) {
+            uint32_t v = queue[head];
+            if (v == to) return dist[v];
+            for (uint32_t e = graph_.offsets[v]; e < graph_.offsets[v + 1]; e++) {
+                uint32_t w = graph_.targets[e];
+                if (dist[w] < 0) {
+                    dist[w] = dist[v] + 1;
+                    queue.push_back(w);
+                }
+            }
+        }
+        return -1;
+    }
+
+    size_t airports() const { return graph_.size(); }
+    size_t bytes() const { return cells_.size(); }
+
+private:
+    void set(size_t from, size_t to, uint8_t hops) {
+        uint8_t& cell = cells_[from * row_bytes_ + to / 2];
+        int shift = to % 2 * 4;
+        cell = (uint8_t)((cell & ~(0xf << shift)) | hops << shift);
+    }
+
+    RouteGraph graph_;
+    size_t row_bytes_ = 0;
+    std::vector<uint8_t> cells_;
+};
+
+VersionedCache<HopMatrix> hop_matrix([](const Dataset& data) { return HopMatrix(data); });
+
+// Contraction hierarchy over the route graph, weighted by great-circle
+// distance in miles, for exact shortest-distance queries.
+//
+// Preprocessing contracts airports least important first. Each round
+// picks an independent set of the remaining airports whose priority
+// (shortcuts added minus arcs removed, plus neighbors already contracted)
+// beats every remaining neighbor's, and contracts the whole set in
+// parallel. Witness searches skip the set, so a witness found for one
+// airport can't run through another being contracted beside it. Only the
+// priorities of the set's neighbors are recomputed between rounds, with
+// a shorter witness search than contraction itself uses. Every airport is
+// contracted, the hubs too, so a query never leaves the hierarchy.
+//
+// A query is a bidirectional Dijkstra that only climbs: forward along
+// arcs to higher-ranked airports, backward along arcs from them. Each
+// side stalls an airport that a higher-ranked one already reaches
+// shorter, since no shortest path climbs through it.
+//
+// Building takes seconds, so it works from a snapshot of the route graph
+// and the airports' coordinates rather than from the session.
+class ContractionHierarchy {
+public:
+    struct Location {
+        bool known = false;
+        double latitude = 0, longitude = 0;
+    };
+
+    // Coordinates of each vertex, taken under the session lock
+    static std::vector<Location> locate(const Dataset& data, const RouteGraph& graph) {
+        std::vector<Location> locations(graph.size());
+        for (uint32_t v = 0; v < graph.size(); v++) {
+            if (const Airport* airport = data.airportByIata(graph.codes[v]))
+                locations[v] = {true, airport->latitude, airport->longitude};
+        }
+        return locations;
+    }
+
+    ContractionHierarchy(std::shared_ptr<const RouteGraph> graph, const std::vector<Location>& locations)
+        : graph_(std::move(graph)) {
+        size_t n = graph_->size();
+        out_.resize(n);
+        in_.resize(n);
+        up_.resize(n);
+        down_.resize(n);
+        for (uint32_t v = 0; v < n; v++) {
+            for (uint32_t e = graph_->offsets[v]; e < graph_->offsets[v + 1]; e++) {
+                uint32_t w = graph_->targets[e];
+                if (!locations[v].known || !locations[w].known) continue;
+                addArc(v, w, calculateDistance(locations[v].latitude, locations[v].longitude,
+                                               locations[w].latitude, locations[w].longitude));
+            }
+        }
+        contract();
+        buildSearchGraphs();
+    }
+
+    std::optional<uint32_t> vertexOf(const std::string& iata) const {
+        auto it = graph_->ids.find(iata);
+        if (it == graph_->ids.end()) return std::nullopt;
+        return it->second;
+    }
+
+    // Shortest distance in miles along routes; nullopt when unreachable
+    std::optional<double> distance(uint32_t from, uint32_t to) const {
+        if (from == to) return 0.0;
+        thread_local QueryState state;
+        state.reset(graph_->size());
+        state.forward.push(from, 0);
+        state.backward.push(to, 0);
+
+        double best = INFINITY;
+        while (!state.forward.heap.empty() || !state.backward.heap.empty()) {
+            for (int direction = 0; direction < 2; direction++) {
+                Search& search = direction == 0 ? state.forward : state.backward;
+                const Search& other = direction == 0 ? state.backward : state.forward;
+                const auto& offsets = direction == 0 ? up_offsets_ : down_offsets_;
+                const auto& arcs = direction == 0 ? up_arcs_ : down_arcs_;
+                if (search.heap.empty()) continue;
+                auto [d, v] = search.heap.top();
+                search.heap.pop();
+                if (d > search.dist[v]) continue;
+                if (d >= best) {
+                    search.heap = {};
+                    continue;
+                }
+                if (other.dist[v] < INFINITY) best = std::min(best, d + other.dist[v]);
+                if (stalled(search, direction == 0 ? down_offsets_ : up_offsets_,
+                            direction == 0 ? down_arcs_ : up_arcs_, v, d))
+                    continue;
+                for (uint32_t e = offsets[v]; e < offsets[v + 1]; e++)
+                    search.push(arcs[e].to, d + arcs[e].weight);
+            }
+        }
+        if (best == INFINITY) return std::nullopt;
+        return best;
+    }
+
+    size_t airports() const { return graph_->size(); }
+    size_t shortcuts() const { return shortcuts_; }
+
+    uint64_t version = 0;  // session version the snapshot was taken at
+    long long elapsed_ms = 0;
+
+private:
+    struct Arc {
+        uint32_t to;
+        double weight;
+    };
+
+    // Distances from one source with a min-heap and a list of touched
+    // vertices, so resetting costs only what the search visited
+    struct Search {
+        using Entry = std::pair<double, uint32_t>;
+        std::vector<double> dist;
+        std::vector<uint32_t> touched;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+
+        void reset(size_t n) {
+            if (dist.size() != n) dist.assign(n, INFINITY);
+            for (uint32_t v : touched) dist[v] = INFINITY;
+            touched.clear();
+            heap = {};
+        }
+
+        void push(uint32_t v, double d) {
+            if (d >= dist[v]) return;
+            if (dist[v] == INFINITY) touched.push_back(v);
+            dist[v] = d;
+            heap.push({d, v});
+        }
+    };
+
+    struct QueryState {
+        Search forward, backward;
+        void reset(size_t n) {
+            forward.reset(n);
+            backward.reset(n);
+        }
+    };
+
+    // Whether some higher-ranked airport with an arc into v already
+    // reaches it shorter than d
+    static bool stalled(const Search& search, const std::vector<uint32_t>& offsets,
+                        const std::vector<Arc>& arcs, uint32_t v, double d) {
+        for (uint32_t e = offsets[v]; e < offsets[v + 1]; e++) {
+            if (search.dist[arcs[e].to] + arcs[e].weight < d) return true;
         }
-        .feature-card h3 {
-            margin-bottom: 10px;
-            font-size: 1.3em;
+        return false;
+    }
+
+    struct Shortcut {
+        uint32_t from, to;
+        double weight;
+    };
+
+    static void unlink(std::vector<Arc>& arcs, uint32_t to) {
+        for (size_t i = 0; i < arcs.size(); i++) {
+            if (arcs[i].to != to) continue;
+            arcs[i] = arcs.back();
+            arcs.pop_back();
+            return;
         }
-        .code-display {
-            background: #2d2d2d;
-            color: #f8f8f2;
-            padding: 20px;
-            border-radius: 8px;
-            overflow-x: auto;
-            font-family: 'Courier New', monospace;
-            font-size: 0.9em;
-            line-height: 1.5;
+    }
+
+    void addArc(uint32_t from, uint32_t to, double weight) {
+        for (Arc& arc : out_[from]) {
+            if (arc.to != to) continue;
+            if (weight < arc.weight) {
+                arc.weight = weight;
+                for (Arc& back : in_[to]) {
+                    if (back.to == from) back.weight = weight;
+                }
+            }
+            return;
         }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <div class="header">
-            <h1>✈️ OpenFlights Air Travel Database</h1>
-            <p>Comprehensive airline and airport data at your fingertips</p>
-        </div>
-        <div class="nav">
-            <div class="nav-grid">
-                <a href="/" class="nav-btn">🏠 Home</a>
-                <a href="/airline" class="nav-btn">✈️ Search Airline</a>
-                <a href="/airport" class="nav-btn">🛫 Search Airport</a>
-                <a href="/reports" class="nav-btn">📊 Reports</a>
-                <a href="/onehop" class="nav-btn">🔄 One-Hop Routes</a>
-                <a href="/manage" class="nav-btn">⚙️ Manage Data</a>
-                <a href="/code" class="nav-btn">💻 View Code</a>
-                <a href="/about" class="nav-btn">ℹ️ About</a>
-            </div>
-        </div>
-        <div class="content">
-)";
-}
+        out_[from].push_back({to, weight});
+        in_[to].push_back({from, weight});
+    }
 
-std::string htmlFooter() {
-    return R"(
-        </div>
-        <div class="footer">
-            <p>Created by )" + STUDENT_NAME + R"( (ID: )" + STUDENT_ID + R"()</p>
-            <p>CIS 22CH Honors Capstone Project | Powered by Crow C++ Framework</p>
-        </div>
-    </div>
-</body>
-</html>
-)";
-}
+    // Shortcuts needed to contract v: one per in/out neighbor pair whose
+    // path through v has no witness avoiding v and the airports in skip
+    std::vector<Shortcut> shortcutsFor(uint32_t v, const std::vector<char>& skip, size_t settle_limit) const {
+        thread_local Search witness;
+        thread_local std::vector<char> target;
+        if (target.size() != graph_->size()) target.assign(graph_->size(), 0);
+        std::vector<Shortcut> shortcuts;
+        for (const Arc& in : in_[v]) {
+            uint32_t u = in.to;
+            double max_through = 0;
+            size_t targets = 0;
+            for (const Arc& out : out_[v]) {
+                if (out.to == u) continue;
+                max_through = std::max(max_through, in.weight + out.weight);
+                target[out.to] = 1;
+                targets++;
+            }
+            if (targets == 0) continue;
+
+            // Stops once every out-neighbor is settled, past the longest
+            // path through v, or at the settle limit; a search cut short
+            // only costs a shortcut that wasn't needed
+            witness.reset(graph_->size());
+            witness.push(u, 0);
+            size_t settled = 0;
+            while (!witness.heap.empty() && settled < settle_limit && targets > 0) {
+                auto [d, x] = witness.heap.top();
+                witness.heap.pop();
+                if (d > witness.dist[x]) continue;
+                if (d > max_through) break;
+                settled++;
+                if (target[x]) targets--;
+                for (const Arc& arc : out_[x]) {
+                    if (arc.to == v || skip[arc.to]) continue;
+                    witness.push(arc.to, d + arc.weight);
+                }
+            }
+            for (const Arc& out : out_[v]) {
+                uint32_t w = out.to;
+                if (w == u) continue;
+                double through = in.weight + out.weight;
+                if (witness.dist[w] > through) shortcuts.push_back({u, w, through});
+            }
+            for (const Arc& out : out_[v]) target[out.to] = 0;
+        }
+        return shortcuts;
+    }
 
-std::string htmlMessagePage(const std::string& title,
-                            const std::string& message,
-                            const std::string& color = "#28a745") // green default
-{
-    std::string html = htmlHeader();
+    // Priorities only order the contraction, so a cheaper search will do
+    int priority(uint32_t v) const {
+        const size_t settle_limit = 10;
+        thread_local std::vector<char> skip;
+        if (skip.size() != graph_->size()) skip.assign(graph_->size(), 0);
+        int arcs = (int)(out_[v].size() + in_[v].size());
+        return (int)shortcutsFor(v, skip, settle_limit).size() - arcs + contracted_neighbors_[v];
+    }
 
-    html += "<div class='result-box' style='border-left-color:" + color + ";'>";
-    html += "<h3>" + title + "</h3>";
-    html += "<p>" + message + "</p>";
-    html += "</div>";
+    void contract() {
+        const size_t settle_limit = 100;
+        size_t n = graph_->size();
+        contracted_.assign(n, 0);
+        contracted_neighbors_.assign(n, 0);
+        rank_.assign(n, 0);
+        std::vector<int> priorities(n);
+        runWorkStealing(n, [&](size_t v) { priorities[v] = priority((uint32_t)v); });
+
+        std::vector<char> in_set(n, 0);
+        std::vector<uint32_t> remaining(n);
+        for (uint32_t v = 0; v < n; v++) remaining[v] = v;
+        uint32_t next_rank = 0;
+
+        while (!remaining.empty()) {
+            auto before = [&](uint32_t a, uint32_t b) {
+                return priorities[a] != priorities[b] ? priorities[a] < priorities[b] : a < b;
+            };
+            std::vector<uint32_t> set;
+            for (uint32_t v : remaining) {
+                bool lowest = true;
+                for (const auto* arcs : {&out_[v], &in_[v]}) {
+                    for (const Arc& arc : *arcs) {
+                        if (!before(v, arc.to)) lowest = false;
+                    }
+                }
+                if (lowest) set.push_back(v);
+            }
+            for (uint32_t v : set) in_set[v] = 1;
+
+            std::vector<std::vector<Shortcut>> shortcuts(set.size());
+            runWorkStealing(set.size(), [&](size_t i) { shortcuts[i] = shortcutsFor(set[i], in_set, settle_limit); });
+
+            // A contracted airport's remaining arcs all lead to airports
+            // ranked above it: they become its search arcs and leave the
+            // neighbors' lists
+            std::vector<uint32_t> touched;
+            for (size_t i = 0; i < set.size(); i++) {
+                uint32_t v = set[i];
+                contracted_[v] = 1;
+                rank_[v] = next_rank++;
+                for (const Shortcut& s : shortcuts[i]) addArc(s.from, s.to, s.weight);
+                shortcuts_ += shortcuts[i].size();
+                for (const Arc& arc : out_[v]) unlink(in_[arc.to], v);
+                for (const Arc& arc : in_[v]) unlink(out_[arc.to], v);
+                for (const auto* arcs : {&out_[v], &in_[v]}) {
+                    for (const Arc& arc : *arcs) {
+                        contracted_neighbors_[arc.to]++;
+                        touched.push_back(arc.to);
+                    }
+                }
+                up_[v] = std::move(out_[v]);
+                down_[v] = std::move(in_[v]);
+                out_[v] = {};
+                in_[v] = {};
+            }
+            for (uint32_t v : set) in_set[v] = 0;
+
+            std::sort(touched.begin(), touched.end());
+            touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+            runWorkStealing(touched.size(), [&](size_t i) { priorities[touched[i]] = priority(touched[i]); });
+            remaining.erase(std::remove_if(remaining.begin(), remaining.end(),
+                                           [&](uint32_t v) { return contracted_[v]; }),
+                            remaining.end());
+        }
+    }
 
-    html += "<p><a href='/manage' class='btn'>← Back to Manage Page</a></p>";
+    // Flatten the search arcs into offsets and arcs: upward arcs for the
+    // forward search and, for the backward search, arcs into each airport
+    // from higher-ranked ones
+    void buildSearchGraphs() {
+        auto flatten = [](std::vector<std::vector<Arc>>& lists, std::vector<uint32_t>& offsets, std::vector<Arc>& arcs) {
+            offsets.assign(1, 0);
+            for (auto& list : lists) {
+                arcs.insert(arcs.end(), list.begin(), list.end());
+                offsets.push_back((uint32_t)arcs.size());
+            }
+            lists = {};
+        };
+        flatten(up_, up_offsets_, up_arcs_);
+        flatten(down_, down_offsets_, down_arcs_);
+        out_ = {};
+        in_ = {};
+    }
 
-    html += htmlFooter();
-    return html;
-}
+    std::shared_ptr<const RouteGraph> graph_;
+    std::vector<std::vector<Arc>> out_;     // remaining graph, during preprocessing
+    std::vector<std::vector<Arc>> in_;
+    std::vector<std::vector<Arc>> up_;      // search arcs, until flattened
+    std::vector<std::vector<Arc>> down_;
+    std::vector<char> contracted_;
+    std::vector<int> contracted_neighbors_;
+    std::vector<uint32_t> rank_;
+    size_t shortcuts_ = 0;
+    std::vector<uint32_t> up_offsets_;
+    std::vector<Arc> up_arcs_;
+    std::vector<uint32_t> down_offsets_;
+    std::vector<Arc> down_arcs_;
+};
 
-inline std::string successPage(const std::string& msg)
-{
-    return htmlMessagePage("Success", msg, "#28a745");  // green
+// Background distance index build, one at a time, like the centrality
+// job. Queries keep using the latest finished index until a newer one
+// replaces it.
+std::atomic<bool> distance_index_running{false};
+std::mutex distance_index_mutex;
+std::shared_ptr<const ContractionHierarchy> distance_index;
+
+// Start a background build; false if one is already running
+bool startDistanceIndex() {
+    bool expected = false;
+    if (!distance_index_running.compare_exchange_strong(expected, true))
+        return false;
+
+    uint64_t version;
+    std::shared_ptr<const RouteGraph> graph;
+    std::vector<ContractionHierarchy::Location> locations;
+    {
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        version = session_version.load();
+        graph = route_graph.get(session, version);
+        locations = ContractionHierarchy::locate(session, *graph);
+    }
+
+    std::thread([graph, locations = std::move(locations), version] {
+        auto start = std::chrono::steady_clock::now();
+        auto index = std::make_shared<ContractionHierarchy>(graph, locations);
+        index->version = version;
+        index->elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        {
+            std::lock_guard<std::mutex> lock(distance_index_mutex);
+            distance_index = index;
+        }
+        distance_index_running = false;
+    }).detach();
+    return true;
 }
 
-inline std::string errorPage(const std::string& msg)
-{
-    return htmlMessagePage("Error", msg, "#dc3545");   // red
+// Latest finished index, starting a rebuild when it is missing or behind
+// the session
+std::shared_ptr<const ContractionHierarchy> currentDistanceIndex() {
+    std::shared_ptr<const ContractionHierarchy> index;
+    {
+        std::lock_guard<std::mutex> lock(distance_index_mutex);
+        index = distance_index;
+    }
+    if (!index || index->version != session_version.load()) startDistanceIndex();
+    return index;
 }
 
-int main() {
-    crow::SimpleApp app;
+crow::json::wvalue distanceIndexStatus() {
+    crow::json::wvalue status;
+    status["running"] = distance_index_running.load();
+    std::lock_guard<std::mutex> lock(distance_index_mutex);
+    if (distance_index) {
+        status["index_version"] = distance_index->version;
+        status["elapsed_ms"] = distance_index->elapsed_ms;
+    }
+    return status;
+}
 
+int main(int argc, char* argv[]) {
     // Load data
-    loadAirports("airports.dat");
-    loadAirlines("airlines.dat");
-    loadRoutes("routes.dat");
+    loadAirports(base, AIRPORTS_FILE);
+    loadAirlines(base, AIRLINES_FILE);
+    loadRoutes(base, ROUTES_FILE);
+
+    // Offline mode: server --onehop-batch pairs.csv writes NDJSON to stdout
+    if (argc == 3 && std::string(argv[1]) == "--onehop-batch") {
+        std::string text = readFile(argv[2]);
+        if (text.empty()) {
+            std::cerr << "Cannot read " << argv[2] << "\n";
+            return 1;
+        }
+        solveOneHopBatch(base, parseOdPairs(text), [](const std::string& lines) {
+            std::cout << lines << std::flush;
+        });
+        return 0;
+    }
+
+    crow::SimpleApp app;
     initializeSession();
+    startDistanceIndex();
 
     // Home page
     CROW_ROUTE(app, "/")([](){
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
         std::string html = htmlHeader();
         html += R"(
             <h2>Welcome to OpenFlights Database</h2>
@@ -551,13 +4718,13 @@ int main() {
             <div class="result-box" style="margin-top: 30px;">
                 <h3>📈 Database Statistics</h3>
                 <div class="result-item">
-                    <strong>Total Airlines:</strong> )" + std::to_string(airlines_by_id.size()) + R"(
+                    <strong>Total Airlines:</strong> )" + std::to_string(base.airlines.size()) + R"(
                 </div>
                 <div class="result-item">
-                    <strong>Total Airports:</strong> )" + std::to_string(airports_by_id.size()) + R"(
+                    <strong>Total Airports:</strong> )" + std::to_string(base.airports.size()) + R"(
                 </div>
                 <div class="result-item">
-                    <strong>Total Routes:</strong> )" + std::to_string(routes.size()) + R"(
+                    <strong>Total Routes:</strong> )" + std::to_string(base.routes.size()) + R"(
                 </div>
             </div>
         )";
@@ -588,42 +4755,106 @@ int main() {
                 </form>
             </div>
         )";
+        html += autocompleteScript("iata", "airlines");
+        html += R"(
+            <h2>Search Airline by Name</h2>
+            <div class="search-form">
+                <form method="GET" action="/airline/find">
+                    <div class="form-group">
+                        <label for="q">Enter an airline name or alias (e.g., Lufthansa):</label>
+                        <input type="text" id="q" name="q" placeholder="Lufthansa" required>
+                    </div>
+                    <button type="submit" class="btn">Find Airlines</button>
+                </form>
+            </div>
+        )";
         html += htmlFooter();
         return html;
     });
 
     CROW_ROUTE(app, "/airline/search")([](const crow::request& req){
-        auto iata = req.url_params.get("iata");
-        std::string html = htmlHeader();
+        return cachedPage("airline|" + cacheKeyParam(req.url_params.get("iata")), [&] {
+            std::shared_lock<std::shared_mutex> lock(session_mutex);
+            auto iata = req.url_params.get("iata");
+            std::string html = htmlHeader();
         
-        if (iata) {
-            std::string iata_code = iata;
-            std::transform(iata_code.begin(), iata_code.end(), iata_code.begin(), ::toupper);
+            if (iata) {
+                std::string iata_code = iata;
+                std::transform(iata_code.begin(), iata_code.end(), iata_code.begin(), ::toupper);
             
-            auto it = session_airlines_by_iata.find(iata_code);
-            if (it != session_airlines_by_iata.end()) {
-                auto airline = it->second;
-                html += R"(<h2>Airline Details</h2>)";
-                html += R"(<div class="result-box">)";
-                html += "<div class='result-item'><strong>ID:</strong> " + std::to_string(airline->id) + "</div>";
-                html += "<div class='result-item'><strong>Name:</strong> " + airline->name + "</div>";
-                html += "<div class='result-item'><strong>Alias:</strong> " + airline->alias + "</div>";
-                html += "<div class='result-item'><strong>IATA:</strong> " + airline->iata + "</div>";
-                html += "<div class='result-item'><strong>ICAO:</strong> " + airline->icao + "</div>";
-                html += "<div class='result-item'><strong>Callsign:</strong> " + airline->callsign + "</div>";
-                html += "<div class='result-item'><strong>Country:</strong> " + airline->country + "</div>";
-                html += "<div class='result-item'><strong>Active:</strong> " + airline->active + "</div>";
-                html += "</div>";
+                // Several airlines can share a code; active ones come first
+                auto codes = airline_codes.get(session, session_version.load());
+                auto matches = codes->find(iata_code);
+                if (matches.size() > 0) {
+                    html += R"(<h2>Airline Details</h2>)";
+                    if (matches.size() > 1)
+                        html += "<p>" + std::to_string(matches.size()) + " airlines share the IATA code '" + iata_code + "'.</p>";
+                    for (int32_t slot : matches) {
+                        const Airline* airline = &session.airlines.at(slot);
+                        html += R"(<div class="result-box">)";
+                        html += "<div class='result-item'><strong>ID:</strong> " + std::to_string(airline->id) + "</div>";
+                        html += "<div class='result-item'><strong>Name:</strong> " + airline->name + "</div>";
+                        html += "<div class='result-item'><strong>Alias:</strong> " + airline->alias + "</div>";
+                        html += "<div class='result-item'><strong>IATA:</strong> " + airline->iata + "</div>";
+                        html += "<div class='result-item'><strong>ICAO:</strong> " + airline->icao + "</div>";
+                        html += "<div class='result-item'><strong>Callsign:</strong> " + airline->callsign + "</div>";
+                        html += "<div class='result-item'><strong>Country:</strong> " + session.dicts.countries.lookup(airline->country) + "</div>";
+                        html += "<div class='result-item'><strong>Active:</strong> " + session.dicts.active.lookup(airline->active) + "</div>";
+                        html += "</div>";
+                    }
+                } else {
+                    html += R"(<div class="result-box" style="border-left-color: #dc3545;">)";
+                    html += "<p>❌ Airline with IATA code '" + iata_code + "' not found.</p>";
+                    html += "</div>";
+                }
+            }
+        
+            html += "<p><a href='/airline' class='btn'>🔙 Search Another Airline</a></p>";
+            html += htmlFooter();
+            return html;
+        });
+    });
+
+    // Fuzzy search of airline names and aliases
+    CROW_ROUTE(app, "/airline/find")([](const crow::request& req){
+        auto q = req.url_params.get("q");
+        return cachedPage(std::string("airline-find|") + (q ? q : ""), [&] {
+            std::shared_lock<std::shared_mutex> lock(session_mutex);
+            std::string query = q ? q : "";
+            std::string html = htmlHeader();
+            html += R"(<h2>Airline Name Search</h2>)";
+
+            auto matches = session.airline_names.search(query, 25);
+            if (!matches.empty()) {
+                html += "<div class='result-box'>";
+                html += "<p>Best matches for '" + htmlEscape(query) + "'</p>";
+                html += "<table><thead><tr>";
+                html += "<th>IATA</th><th>Name</th><th>Alias</th><th>Country</th><th>Match</th>";
+                html += "</tr></thead><tbody>";
+                for (const auto& match : matches) {
+                    const Airline& airline = session.airlines.at(match.slot);
+                    html += "<tr>";
+                    if (airline.iata.empty() || airline.iata == "\\N")
+                        html += "<td>" + airline.iata + "</td>";
+                    else
+                        html += "<td><a href='/airline/search?iata=" + airline.iata + "'>" + airline.iata + "</a></td>";
+                    html += "<td>" + airline.name + "</td>";
+                    html += "<td>" + airline.alias + "</td>";
+                    html += "<td>" + session.dicts.countries.lookup(airline.country) + "</td>";
+                    html += "<td>" + std::to_string(static_cast<int>(match.score * 100)) + "%</td>";
+                    html += "</tr>";
+                }
+                html += "</tbody></table></div>";
             } else {
                 html += R"(<div class="result-box" style="border-left-color: #dc3545;">)";
-                html += "<p>❌ Airline with IATA code '" + iata_code + "' not found.</p>";
+                html += "<p>❌ No airlines match '" + htmlEscape(query) + "'.</p>";
                 html += "</div>";
             }
-        }
-        
-        html += "<p><a href='/airline' class='btn'>🔙 Search Another Airline</a></p>";
-        html += htmlFooter();
-        return html;
+
+            html += "<p><a href='/airline' class='btn'>🔙 Search Another Airline</a></p>";
+            html += htmlFooter();
+            return html;
+        });
     });
 
     // Search airport by IATA
@@ -641,48 +4872,104 @@ int main() {
                 </form>
             </div>
         )";
+        html += autocompleteScript("iata", "airports");
+        html += R"(
+            <h2>Search Airport by Name</h2>
+            <div class="search-form">
+                <form method="GET" action="/airport/find">
+                    <div class="form-group">
+                        <label for="q">Enter an airport name or city (e.g., Heathrow):</label>
+                        <input type="text" id="q" name="q" placeholder="Heathrow" required>
+                    </div>
+                    <button type="submit" class="btn">Find Airports</button>
+                </form>
+            </div>
+        )";
         html += htmlFooter();
         return html;
     });
 
     CROW_ROUTE(app, "/airport/search")([](const crow::request& req){
-        auto iata = req.url_params.get("iata");
-        std::string html = htmlHeader();
+        return cachedPage("airport|" + cacheKeyParam(req.url_params.get("iata")), [&] {
+            std::shared_lock<std::shared_mutex> lock(session_mutex);
+            auto iata = req.url_params.get("iata");
+            std::string html = htmlHeader();
         
-        if (iata) {
-            std::string iata_code = iata;
-            std::transform(iata_code.begin(), iata_code.end(), iata_code.begin(), ::toupper);
+            if (iata) {
+                std::string iata_code = iata;
+                std::transform(iata_code.begin(), iata_code.end(), iata_code.begin(), ::toupper);
             
-            auto it = session_airports_by_iata.find(iata_code);
-            if (it != session_airports_by_iata.end()) {
-                auto airport = it->second;
-                html += R"(<h2>Airport Details</h2>)";
-                html += R"(<div class="result-box">)";
-                html += "<div class='result-item'><strong>ID:</strong> " + std::to_string(airport->id) + "</div>";
-                html += "<div class='result-item'><strong>Name:</strong> " + airport->name + "</div>";
-                html += "<div class='result-item'><strong>City:</strong> " + airport->city + "</div>";
-                html += "<div class='result-item'><strong>Country:</strong> " + airport->country + "</div>";
-                html += "<div class='result-item'><strong>IATA:</strong> " + airport->iata + "</div>";
-                html += "<div class='result-item'><strong>ICAO:</strong> " + airport->icao + "</div>";
-                html += "<div class='result-item'><strong>Latitude:</strong> " + std::to_string(airport->latitude) + "</div>";
-                html += "<div class='result-item'><strong>Longitude:</strong> " + std::to_string(airport->longitude) + "</div>";
-                html += "<div class='result-item'><strong>Altitude:</strong> " + std::to_string(airport->altitude) + " ft</div>";
-                html += "<div class='result-item'><strong>Timezone:</strong> " + std::to_string(airport->timezone) + "</div>";
-                html += "<div class='result-item'><strong>DST:</strong> " + airport->dst + "</div>";
-                html += "<div class='result-item'><strong>TZ Database:</strong> " + airport->tz_database + "</div>";
-                html += "<div class='result-item'><strong>Type:</strong> " + airport->type + "</div>";
-                html += "<div class='result-item'><strong>Source:</strong> " + airport->source + "</div>";
-                html += "</div>";
+                if (const Airport* airport = session.airportByIata(iata_code)) {
+                    html += R"(<h2>Airport Details</h2>)";
+                    html += R"(<div class="result-box">)";
+                    html += "<div class='result-item'><strong>ID:</strong> " + std::to_string(airport->id) + "</div>";
+                    html += "<div class='result-item'><strong>Name:</strong> " + airport->name + "</div>";
+                    html += "<div class='result-item'><strong>City:</strong> " + airport->city + "</div>";
+                    html += "<div class='result-item'><strong>Country:</strong> " + session.dicts.countries.lookup(airport->country) + "</div>";
+                    html += "<div class='result-item'><strong>IATA:</strong> " + airport->iata + "</div>";
+                    html += "<div class='result-item'><strong>ICAO:</strong> " + airport->icao + "</div>";
+                    html += "<div class='result-item'><strong>Latitude:</strong> " + std::to_string(airport->latitude) + "</div>";
+                    html += "<div class='result-item'><strong>Longitude:</strong> " + std::to_string(airport->longitude) + "</div>";
+                    html += "<div class='result-item'><strong>Altitude:</strong> " + std::to_string(airport->altitude) + " ft</div>";
+                    html += "<div class='result-item'><strong>Timezone:</strong> " + std::to_string(airport->timezone) + "</div>";
+                    html += "<div class='result-item'><strong>DST:</strong> " + session.dicts.dst.lookup(airport->dst) + "</div>";
+                    html += "<div class='result-item'><strong>TZ Database:</strong> " + session.dicts.timezones.lookup(airport->tz_database) + "</div>";
+                    html += "<div class='result-item'><strong>Type:</strong> " + session.dicts.airport_types.lookup(airport->type) + "</div>";
+                    html += "<div class='result-item'><strong>Source:</strong> " + session.dicts.sources.lookup(airport->source) + "</div>";
+                    html += "</div>";
+                } else {
+                    html += R"(<div class="result-box" style="border-left-color: #dc3545;">)";
+                    html += "<p>❌ Airport with IATA code '" + iata_code + "' not found.</p>";
+                    html += "</div>";
+                }
+            }
+        
+            html += "<p><a href='/airport' class='btn'>🔙 Search Another Airport</a></p>";
+            html += htmlFooter();
+            return html;
+        });
+    });
+
+    // Fuzzy search of airport names and cities
+    CROW_ROUTE(app, "/airport/find")([](const crow::request& req){
+        auto q = req.url_params.get("q");
+        return cachedPage(std::string("airport-find|") + (q ? q : ""), [&] {
+            std::shared_lock<std::shared_mutex> lock(session_mutex);
+            std::string query = q ? q : "";
+            std::string html = htmlHeader();
+            html += R"(<h2>Airport Name Search</h2>)";
+
+            auto matches = session.airport_names.search(query, 25);
+            if (!matches.empty()) {
+                html += "<div class='result-box'>";
+                html += "<p>Best matches for '" + htmlEscape(query) + "'</p>";
+                html += "<table><thead><tr>";
+                html += "<th>IATA</th><th>Name</th><th>City</th><th>Country</th><th>Match</th>";
+                html += "</tr></thead><tbody>";
+                for (const auto& match : matches) {
+                    const Airport& airport = session.airports.at(match.slot);
+                    html += "<tr>";
+                    if (airport.iata.empty() || airport.iata == "\\N")
+                        html += "<td>" + airport.iata + "</td>";
+                    else
+                        html += "<td><a href='/airport/search?iata=" + airport.iata + "'>" + airport.iata + "</a></td>";
+                    html += "<td>" + airport.name + "</td>";
+                    html += "<td>" + airport.city + "</td>";
+                    html += "<td>" + session.dicts.countries.lookup(airport.country) + "</td>";
+                    html += "<td>" + std::to_string(static_cast<int>(match.score * 100)) + "%</td>";
+                    html += "</tr>";
+                }
+                html += "</tbody></table></div>";
             } else {
                 html += R"(<div class="result-box" style="border-left-color: #dc3545;">)";
-                html += "<p>❌ Airport with IATA code '" + iata_code + "' not found.</p>";
+                html += "<p>❌ No airports match '" + htmlEscape(query) + "'.</p>";
                 html += "</div>";
             }
-        }
-        
-        html += "<p><a href='/airport' class='btn'>🔙 Search Another Airport</a></p>";
-        html += htmlFooter();
-        return html;
+
+            html += "<p><a href='/airport' class='btn'>🔙 Search Another Airport</a></p>";
+            html += htmlFooter();
+            return html;
+        });
     });
 
     // Reports page
@@ -692,15 +4979,51 @@ int main() {
             <h2>📊 Generate Reports</h2>
             
             <div class="search-form">
-                <h3>Airlines Ordered by IATA Code</h3>
+                <h3>All Airlines</h3>
                 <form method="GET" action="/reports/airlines">
+                    <div class="form-group">
+                        <label for="airlines-sort">Order By:</label>
+                        <select id="airlines-sort" name="sort">
+                            <option value="iata">IATA Code</option>
+                            <option value="name">Name</option>
+                            <option value="country">Country</option>
+                            <option value="routes">Route Count</option>
+                        </select>
+                    </div>
+                    <div class="form-group">
+                        <label for="airlines-limit">Rows Per Page:</label>
+                        <select id="airlines-limit" name="limit">
+                            <option value="">All</option>
+                            <option value="50">50</option>
+                            <option value="100">100</option>
+                            <option value="500">500</option>
+                        </select>
+                    </div>
                     <button type="submit" class="btn">Generate Airlines Report</button>
                 </form>
             </div>
             
             <div class="search-form">
-                <h3>Airports Ordered by IATA Code</h3>
+                <h3>All Airports</h3>
                 <form method="GET" action="/reports/airports">
+                    <div class="form-group">
+                        <label for="airports-sort">Order By:</label>
+                        <select id="airports-sort" name="sort">
+                            <option value="iata">IATA Code</option>
+                            <option value="name">Name</option>
+                            <option value="country">Country</option>
+                            <option value="routes">Route Count</option>
+                        </select>
+                    </div>
+                    <div class="form-group">
+                        <label for="airports-limit">Rows Per Page:</label>
+                        <select id="airports-limit" name="limit">
+                            <option value="">All</option>
+                            <option value="50">50</option>
+                            <option value="100">100</option>
+                            <option value="500">500</option>
+                        </select>
+                    </div>
                     <button type="submit" class="btn">Generate Airports Report</button>
                 </form>
             </div>
@@ -712,6 +5035,10 @@ int main() {
                         <label for="iata">Enter Airline IATA Code:</label>
                         <input type="text" id="iata" name="iata" placeholder="AA" maxlength="3" required>
                     </div>
+                    <div class="form-group">
+                        <label for="airline-routes-top">Show Top (optional):</label>
+                        <input type="number" id="airline-routes-top" name="top" min="1" placeholder="All">
+                    </div>
                     <button type="submit" class="btn">Generate Report</button>
                 </form>
             </div>
@@ -723,6 +5050,10 @@ int main() {
                         <label for="iata">Enter Airport IATA Code:</label>
                         <input type="text" id="iata" name="iata" placeholder="SFO" maxlength="3" required>
                     </div>
+                    <div class="form-group">
+                        <label for="airport-routes-top">Show Top (optional):</label>
+                        <input type="number" id="airport-routes-top" name="top" min="1" placeholder="All">
+                    </div>
                     <button type="submit" class="btn">Generate Report</button>
                 </form>
             </div>
@@ -925,132 +5256,39 @@ int main() {
     CROW_ROUTE(app, "/onehop/search")([](const crow::request& req){
         auto source_param = req.url_params.get("source");
         auto dest_param = req.url_params.get("dest");
-        
-        std::string html = htmlHeader();
-        html += R"(<h2>🔄 One-Hop Route Results</h2>)";
-        
+
         if (source_param && dest_param) {
             std::string source = source_param;
             std::string dest = dest_param;
             std::transform(source.begin(), source.end(), source.begin(), ::toupper);
             std::transform(dest.begin(), dest.end(), dest.begin(), ::toupper);
-            
-            auto source_it = session_airports_by_iata.find(source);
-            auto dest_it = session_airports_by_iata.find(dest);
-            
-            if (source_it != session_airports_by_iata.end() && dest_it != session_airports_by_iata.end()) {
-                auto source_airport = source_it->second;
-                auto dest_airport = dest_it->second;
-                
-                // Find one-hop routes
-                struct RouteInfo {
-                    std::string intermediate;
-                    std::string airline1;
-                    std::string airline2;
-                    double distance;
-                };
-                
-                std::vector<RouteInfo> one_hop_routes;
-                
-                // Find routes from source
-                std::set<std::string> intermediates;
-                for (const auto& route : session_routes) {
-                    if (route->source_airport == source && route->stops == 0) {
-                        intermediates.insert(route->dest_airport);
-                    }
-                }
-                
-                // Find routes from intermediates to destination
-                for (const auto& intermediate : intermediates) {
-                    for (const auto& route : session_routes) {
-                        if (route->source_airport == intermediate && 
-                            route->dest_airport == dest && 
-                            route->stops == 0) {
-                            
-                            // Find airline names
-                            std::string airline1 = "Unknown";
-                            std::string airline2 = "Unknown";
-                            
-                            for (const auto& r1 : session_routes) {
-                                if (r1->source_airport == source && r1->dest_airport == intermediate) {
-                                    auto a_it = session_airlines_by_iata.find(r1->airline_code);
-                                    if (a_it != session_airlines_by_iata.end()) {
-                                        airline1 = a_it->second->name;
-                                    }
-                                    break;
-                                }
-                            }
-                            
-                            auto a_it = session_airlines_by_iata.find(route->airline_code);
-                            if (a_it != session_airlines_by_iata.end()) {
-                                airline2 = a_it->second->name;
-                            }
-                            
-                            // Calculate distance
-                            auto inter_it = session_airports_by_iata.find(intermediate);
-                            if (inter_it != session_airports_by_iata.end()) {
-                                auto inter_airport = inter_it->second;
-                                double dist1 = calculateDistance(
-                                    source_airport->latitude, source_airport->longitude,
-                                    inter_airport->latitude, inter_airport->longitude
-                                );
-                                double dist2 = calculateDistance(
-                                    inter_airport->latitude, inter_airport->longitude,
-                                    dest_airport->latitude, dest_airport->longitude
-                                );
-                                
-                                RouteInfo info;
-                                info.intermediate = intermediate;
-                                info.airline1 = airline1;
-                                info.airline2 = airline2;
-                                info.distance = dist1 + dist2;
-                                one_hop_routes.push_back(info);
-                            }
-                        }
-                    }
-                }
-                
-                // Sort by distance
-                std::sort(one_hop_routes.begin(), one_hop_routes.end(),
-                    [](const RouteInfo& a, const RouteInfo& b) {
-                        return a.distance < b.distance;
-                    });
-                
-                if (!one_hop_routes.empty()) {
-                    html += "<div class='result-box'>";
-                    html += "<h3>Found " + std::to_string(one_hop_routes.size()) + " one-hop route(s)</h3>";
-                    html += "<table><thead><tr>";
-                    html += "<th>Rank</th><th>Route</th><th>Airlines</th><th>Total Distance (miles)</th>";
-                    html += "</tr></thead><tbody>";
-                    
-                    int rank = 1;
-                    for (const auto& route_info : one_hop_routes) {
-                        html += "<tr>";
-                        html += "<td>" + std::to_string(rank++) + "</td>";
-                        html += "<td>" + source + " → " + route_info.intermediate + " → " + dest + "</td>";
-                        html += "<td>" + route_info.airline1 + " / " + route_info.airline2 + "</td>";
-                        html += "<td>" + std::to_string(static_cast<int>(route_info.distance)) + "</td>";
-                        html += "</tr>";
-                    }
-                    
-                    html += "</tbody></table></div>";
-                } else {
-                    html += "<div class='result-box' style='border-left-color: #ffc107;'>";
-                    html += "<p>⚠️ No one-hop routes found between " + source + " and " + dest + "</p>";
-                    html += "</div>";
-                }
-            } else {
-                html += "<div class='result-box' style='border-left-color: #dc3545;'>";
-                html += "<p>❌ One or both airports not found.</p>";
-                html += "</div>";
-            }
+
+            return cachedPage("onehop|" + source + "|" + dest, [&] {
+                return renderOneHopPage(source, dest);
+            });
         }
-        
+
+        std::string html = htmlHeader();
+        html += R"(<h2>🔄 One-Hop Route Results</h2>)";
         html += "<p><a href='/onehop' class='btn'>🔙 Search Again</a></p>";
         html += htmlFooter();
         return html;
     });
 
+    // Batch one-hop search: a body of "SRC,DST" lines in, one NDJSON line
+    // per pair out (at most 100000 pairs), streamed as origins are solved
+    CROW_ROUTE(app, "/api/v1/onehop:batch").methods("POST"_method)
+    ([](const crow::request& req) {
+        auto pairs = parseOdPairs(req.body);
+        if (pairs.size() > 100000) return jsonError(400, "at most 100000 pairs per batch");
+
+        auto plan = std::make_shared<const OneHopPlan>(planOneHopBatch(std::move(pairs)));
+        crow::response res;
+        res.set_header("Content-Type", "application/x-ndjson");
+        res.set_chunked_body(streamOneHopBatch(plan));
+        return res;
+    });
+
     // Data management page
     CROW_ROUTE(app, "/manage")([](const crow::request& req){
         std::string html = htmlHeader();
@@ -1209,250 +5447,235 @@ int main() {
                     <button class="btn" style="background:#d9534f;">Delete</button>
                 </form>
             </div>
-        )";
-        html += htmlFooter();
-        return html;
-    });
-
-    // Report handlers (continued)
-    CROW_ROUTE(app, "/reports/airlines")([](const crow::request& req){
-        std::string html = htmlHeader();
-        html += R"(<h2>📊 All Airlines (Ordered by IATA Code)</h2>)";
-        
-        std::vector<std::shared_ptr<Airline>> sorted_airlines;
-        for (const auto& pair : session_airlines_by_iata) {
-            sorted_airlines.push_back(pair.second);
-        }
-        
-        std::sort(sorted_airlines.begin(), sorted_airlines.end(),
-            [](const std::shared_ptr<Airline>& a, const std::shared_ptr<Airline>& b) {
-                return a->iata < b->iata;
-            });
-        
-        html += "<div class='result-box'>";
-        html += "<p>Total Airlines: " + std::to_string(sorted_airlines.size()) + "</p>";
-        html += "<table><thead><tr>";
-        html += "<th>IATA</th><th>Name</th><th>Country</th><th>Active</th>";
-        html += "</tr></thead><tbody>";
-        
-        for (const auto& airline : sorted_airlines) {
-            html += "<tr>";
-            html += "<td>" + airline->iata + "</td>";
-            html += "<td>" + airline->name + "</td>";
-            html += "<td>" + airline->country + "</td>";
-            html += "<td>" + airline->active + "</td>";
-            html += "</tr>";
-        }
-        
-        html += "</tbody></table></div>";
-        html += "<p><a href='/reports' class='btn'>🔙 Back to Reports</a></p>";
-        html += htmlFooter();
-        return html;
-    });
 
-    CROW_ROUTE(app, "/reports/airports")([](const crow::request& req){
-        std::string html = htmlHeader();
-        html += R"(<h2>📊 All Airports (Ordered by IATA Code)</h2>)";
-        
-        std::vector<std::shared_ptr<Airport>> sorted_airports;
-        for (const auto& pair : session_airports_by_iata) {
-            sorted_airports.push_back(pair.second);
-        }
-        
-        std::sort(sorted_airports.begin(), sorted_airports.end(),
-            [](const std::shared_ptr<Airport>& a, const std::shared_ptr<Airport>& b) {
-                return a->iata < b->iata;
-            });
-        
-        html += "<div class='result-box'>";
-        html += "<p>Total Airports: " + std::to_string(sorted_airports.size()) + "</p>";
-        html += "<table><thead><tr>";
-        html += "<th>IATA</th><th>Name</th><th>City</th><th>Country</th>";
-        html += "</tr></thead><tbody>";
-        
-        for (const auto& airport : sorted_airports) {
-            html += "<tr>";
-            html += "<td>" + airport->iata + "</td>";
-            html += "<td>" + airport->name + "</td>";
-            html += "<td>" + airport->city + "</td>";
-            html += "<td>" + airport->country + "</td>";
-            html += "</tr>";
-        }
-        
-        html += "</tbody></table></div>";
-        html += "<p><a href='/reports' class='btn'>🔙 Back to Reports</a></p>";
+            <div class="search-form">
+                <h3>Bulk Import (.dat files, optionally gzip)</h3>
+                <form method="POST" action="/manage/import" enctype="multipart/form-data">
+                    <div class="form-group">
+                        <label>airports.dat:</label>
+                        <input type="file" name="airports">
+                    </div>
+                    <div class="form-group">
+                        <label>airlines.dat:</label>
+                        <input type="file" name="airlines">
+                    </div>
+                    <div class="form-group">
+                        <label>routes.dat:</label>
+                        <input type="file" name="routes">
+                    </div>
+                    <button class="btn">Import</button>
+                </form>
+            </div>
+        )";
         html += htmlFooter();
-        return html;
-    });
-
-    CROW_ROUTE(app, "/reports/airline-routes")([](const crow::request& req) {
-        auto iata = req.url_params.get("iata");
-        std::string html = htmlHeader();
-
-        html += R"(<h2>📊 Airline Route Report</h2>)";
-
-        if (!iata) {
-            html += R"(<div class="result-box" style="border-left-color:#dc3545;">
-                        <p>❌ Missing IATA parameter.</p></div>)";
-            html += htmlFooter();
-            return html;
-        }
+        return html;
+    });
 
-        std::string airline_code = iata;
-        std::transform(airline_code.begin(), airline_code.end(), airline_code.begin(), ::toupper);
+    // Report handlers (continued)
+    // The full-table reports are streamed in chunks rather than cached
+    // Table reports, ?sort=iata|name|country|routes, paged with
+    // ?limit=N&after=cursor or streamed in full without a limit
+    CROW_ROUTE(app, "/reports/airlines")([](const crow::request& req){
+        return tableReport(req, "/reports/airlines", true, "Airlines",
+            "<th>IATA</th><th>Name</th><th>Country</th><th>Active</th>",
+            [](int32_t slot) {
+                const Airline& airline = session.airlines.at(slot);
+                std::string row = "<tr>";
+                row += "<td>" + airline.iata + "</td>";
+                row += "<td>" + airline.name + "</td>";
+                row += "<td>" + session.dicts.countries.lookup(airline.country) + "</td>";
+                row += "<td>" + session.dicts.active.lookup(airline.active) + "</td>";
+                row += "</tr>";
+                return row;
+            });
+    });
 
-        auto it = session_airlines_by_iata.find(airline_code);
-        if (it == session_airlines_by_iata.end()) {
-            html += R"(<div class="result-box" style="border-left-color:#dc3545;">
-                        <p>❌ Airline not found.</p></div>)";
-            html += htmlFooter();
-            return html;
-        }
+    CROW_ROUTE(app, "/reports/airports")([](const crow::request& req){
+        return tableReport(req, "/reports/airports", false, "Airports",
+            "<th>IATA</th><th>Name</th><th>City</th><th>Country</th>",
+            [](int32_t slot) {
+                const Airport& airport = session.airports.at(slot);
+                std::string row = "<tr>";
+                row += "<td>" + airport.iata + "</td>";
+                row += "<td>" + airport.name + "</td>";
+                row += "<td>" + airport.city + "</td>";
+                row += "<td>" + session.dicts.countries.lookup(airport.country) + "</td>";
+                row += "</tr>";
+                return row;
+            });
+    });
 
-        auto airline = it->second;
+    CROW_ROUTE(app, "/reports/airline-routes")([](const crow::request& req) {
+        size_t top = queryTop(req);
+        return cachedPage("reports/airline-routes|" + cacheKeyParam(req.url_params.get("iata")) +
+                          "|" + std::to_string(top), [&] {
+            std::shared_lock<std::shared_mutex> lock(session_mutex);
+            auto iata = req.url_params.get("iata");
+            std::string html = htmlHeader();
+
+            html += R"(<h2>📊 Airline Route Report</h2>)";
+
+            if (!iata) {
+                html += R"(<div class="result-box" style="border-left-color:#dc3545;">
+                            <p>❌ Missing IATA parameter.</p></div>)";
+                html += htmlFooter();
+                return html;
+            }
 
-        // Count airport occurrences
-        std::unordered_map<std::string, int> airport_counts;
+            std::string airline_code = iata;
+            std::transform(airline_code.begin(), airline_code.end(), airline_code.begin(), ::toupper);
 
-        for (auto& route : session_routes) {
-            if (route->stops == 0 && route->airline_code == airline_code) {
-                if (!route->source_airport.empty())
-                    airport_counts[route->source_airport]++;
-                if (!route->dest_airport.empty())
-                    airport_counts[route->dest_airport]++;
+            auto codes = airline_codes.get(session, session_version.load());
+            const Airline* airline = codes->primary(session, airline_code);
+            if (!airline) {
+                html += R"(<div class="result-box" style="border-left-color:#dc3545;">
+                            <p>❌ Airline not found.</p></div>)";
+                html += htmlFooter();
+                return html;
             }
-        }
 
-        // Convert to vector for sorting
-        std::vector<std::pair<std::string, int>> sorted;
-        for (auto& pair : airport_counts) sorted.push_back(pair);
 
-        std::sort(sorted.begin(), sorted.end(),
-                  [](auto& a, auto& b) { return a.second > b.second; });
+            // Count airport occurrences
+            std::unordered_map<std::string, int> airport_counts;
 
-        // Build HTML
-        html += "<div class='result-box'>";
-        html += "<h3>Airline: " + airline->name +
-                " (" + airline_code + ")</h3>";
-        html += "<p>Total connected airports: " + std::to_string(sorted.size()) + "</p>";
+            for (auto& route : session.routes) {
+                if (route.stops == 0 && route.airline_code == airline_code) {
+                    if (!route.source_airport.empty())
+                        airport_counts[route.source_airport]++;
+                    if (!route.dest_airport.empty())
+                        airport_counts[route.dest_airport]++;
+                }
+            }
 
-        html += R"(
-        <table>
-            <thead>
-                <tr>
-                    <th>Airport</th>
-                    <th>City</th>
-                    <th>Country</th>
-                    <th>Routes</th>
-                </tr>
-            </thead>
-            <tbody>
-    )";
+            // Most routes first; ?top=N keeps only the first N
+            std::vector<std::pair<std::string, int>> sorted = rankTallies(airport_counts, top);
+
+            // Build HTML
+            html += "<div class='result-box'>";
+            html += "<h3>Airline: " + airline->name +
+                    " (" + airline_code + ")</h3>";
+            html += "<p>Total connected airports: " + std::to_string(airport_counts.size()) + "</p>";
+            if (sorted.size() < airport_counts.size())
+                html += "<p>Showing the top " + std::to_string(sorted.size()) + "</p>";
+
+            html += R"(
+            <table>
+                <thead>
+                    <tr>
+                        <th>Airport</th>
+                        <th>City</th>
+                        <th>Country</th>
+                        <th>Routes</th>
+                    </tr>
+                </thead>
+                <tbody>
+        )";
 
-        for (auto& p : sorted) {
-            auto airport_it = session_airports_by_iata.find(p.first);
-            if (airport_it != session_airports_by_iata.end()) {
-                auto ap = airport_it->second;
+            for (auto& p : sorted) {
+                if (const Airport* ap = session.airportByIata(p.first)) {
 
-                html += "<tr>";
-                html += "<td>" + ap->iata + " (" + ap->name + ")</td>";
-                html += "<td>" + ap->city + "</td>";
-                html += "<td>" + ap->country + "</td>";
-                html += "<td>" + std::to_string(p.second) + "</td>";
-                html += "</tr>";
+                    html += "<tr>";
+                    html += "<td>" + ap->iata + " (" + ap->name + ")</td>";
+                    html += "<td>" + ap->city + "</td>";
+                    html += "<td>" + session.dicts.countries.lookup(ap->country) + "</td>";
+                    html += "<td>" + std::to_string(p.second) + "</td>";
+                    html += "</tr>";
+                }
             }
-        }
 
-        html += "</tbody></table></div>";
-        html += "<p><a href='/reports' class='btn'>🔙 Back to Reports</a></p>";
-        html += htmlFooter();
-        return html;
+            html += "</tbody></table></div>";
+            html += "<p><a href='/reports' class='btn'>🔙 Back to Reports</a></p>";
+            html += htmlFooter();
+            return html;
+        });
     });
 
     CROW_ROUTE(app, "/reports/airport-routes")([](const crow::request& req) {
-        auto iata = req.url_params.get("iata");
-        std::string html = htmlHeader();
-
-        html += R"(<h2>📊 Airport Route Report</h2>)";
-
-        if (!iata) {
-            html += R"(<div class="result-box" style="border-left-color:#dc3545;">
-                        <p>❌ Missing IATA parameter.</p></div>)";
-            html += htmlFooter();
-            return html;
-        }
+        size_t top = queryTop(req);
+        return cachedPage("reports/airport-routes|" + cacheKeyParam(req.url_params.get("iata")) +
+                          "|" + std::to_string(top), [&] {
+            std::shared_lock<std::shared_mutex> lock(session_mutex);
+            auto codes = airline_codes.get(session, session_version.load());
+            auto iata = req.url_params.get("iata");
+            std::string html = htmlHeader();
+
+            html += R"(<h2>📊 Airport Route Report</h2>)";
+
+            if (!iata) {
+                html += R"(<div class="result-box" style="border-left-color:#dc3545;">
+                            <p>❌ Missing IATA parameter.</p></div>)";
+                html += htmlFooter();
+                return html;
+            }
 
-        std::string airport_code = iata;
-        std::transform(airport_code.begin(), airport_code.end(), airport_code.begin(), ::toupper);
+            std::string airport_code = iata;
+            std::transform(airport_code.begin(), airport_code.end(), airport_code.begin(), ::toupper);
 
-        auto it = session_airports_by_iata.find(airport_code);
-        if (it == session_airports_by_iata.end()) {
-            html += R"(<div class="result-box" style="border-left-color:#dc3545;">
-                        <p>❌ Airport not found.</p></div>)";
-            html += htmlFooter();
-            return html;
-        }
+            const Airport* airport = session.airportByIata(airport_code);
+            if (!airport) {
+                html += R"(<div class="result-box" style="border-left-color:#dc3545;">
+                            <p>❌ Airport not found.</p></div>)";
+                html += htmlFooter();
+                return html;
+            }
 
-        auto airport = it->second;
 
-        // Count airlines serving this airport
-        std::unordered_map<std::string, int> airline_counts;
+            // Count airlines serving this airport
+            std::unordered_map<std::string, int> airline_counts;
 
-        for (auto& route : session_routes) {
-            if (route->stops == 0 &&
-                (route->source_airport == airport_code || route->dest_airport == airport_code)) {
+            for (auto& route : session.routes) {
+                if (route.stops == 0 &&
+                    (route.source_airport == airport_code || route.dest_airport == airport_code)) {
 
-                if (!route->airline_code.empty())
-                    airline_counts[route->airline_code]++;
+                    if (!route.airline_code.empty())
+                        airline_counts[route.airline_code]++;
+                }
             }
-        }
-
-        // Convert to vector for sorting
-        std::vector<std::pair<std::string, int>> sorted;
-        for (auto& pair : airline_counts) sorted.push_back(pair);
-
-        std::sort(sorted.begin(), sorted.end(),
-                  [](auto& a, auto& b) { return a.second > b.second; });
 
-        // Build HTML
-        html += "<div class='result-box'>";
-        html += "<h3>Airport: " + airport->name +
-                " (" + airport_code + ")</h3>";
-        html += "<p>Total airlines serving this airport: " + std::to_string(sorted.size()) + "</p>";
+            // Most routes first; ?top=N keeps only the first N
+            std::vector<std::pair<std::string, int>> sorted = rankTallies(airline_counts, top);
+
+            // Build HTML
+            html += "<div class='result-box'>";
+            html += "<h3>Airport: " + airport->name +
+                    " (" + airport_code + ")</h3>";
+            html += "<p>Total airlines serving this airport: " + std::to_string(airline_counts.size()) + "</p>";
+            if (sorted.size() < airline_counts.size())
+                html += "<p>Showing the top " + std::to_string(sorted.size()) + "</p>";
+
+            html += R"(
+            <table>
+                <thead>
+                    <tr>
+                        <th>Airline</th>
+                        <th>Country</th>
+                        <th>Routes</th>
+                    </tr>
+                </thead>
+                <tbody>
+        )";
 
-        html += R"(
-        <table>
-            <thead>
-                <tr>
-                    <th>Airline</th>
-                    <th>Country</th>
-                    <th>Routes</th>
-                </tr>
-            </thead>
-            <tbody>
-    )";
+            for (auto& p : sorted) {
+                const Airline* al = codes->primary(session, p.first);
 
-        for (auto& p : sorted) {
-            auto airline_it = session_airlines_by_iata.find(p.first);
+                html += "<tr>";
 
-            html += "<tr>";
+                if (al) {
+                    html += "<td>" + al->name + " (" + al->iata + ")</td>";
+                    html += "<td>" + session.dicts.countries.lookup(al->country) + "</td>";
+                } else {
+                    html += "<td>Unknown (" + p.first + ")</td><td>Unknown</td>";
+                }
 
-            if (airline_it != session_airlines_by_iata.end()) {
-                auto al = airline_it->second;
-                html += "<td>" + al->name + " (" + al->iata + ")</td>";
-                html += "<td>" + al->country + "</td>";
-            } else {
-                html += "<td>Unknown (" + p.first + ")</td><td>Unknown</td>";
+                html += "<td>" + std::to_string(p.second) + "</td>";
+                html += "</tr>";
             }
 
-            html += "<td>" + std::to_string(p.second) + "</td>";
-            html += "</tr>";
-        }
-
-        html += "</tbody></table></div>";
-        html += "<p><a href='/reports' class='btn'>🔙 Back to Reports</a></p>";
-        html += htmlFooter();
-        return html;
+            html += "</tbody></table></div>";
+            html += "<p><a href='/reports' class='btn'>🔙 Back to Reports</a></p>";
+            html += htmlFooter();
+            return html;
+        });
     });
 
     // Airline – INSERT (HTML response)
@@ -1480,20 +5703,11 @@ int main() {
 
         std::transform(iata.begin(), iata.end(), iata.begin(), ::toupper);
 
-        if (session_airlines_by_id.count(id))
-            return crow::response(errorPage("Airline ID already exists."));
-
-        if (session_airlines_by_iata.count(iata))
-            return crow::response(errorPage("Airline IATA already exists."));
-
-        auto al = std::make_shared<Airline>();
-        al->id      = id;
-        al->iata    = iata;
-        al->name    = name;
-        al->country = country;
-
-        session_airlines_by_id[id]     = al;
-        session_airlines_by_iata[iata] = al;
+        std::string error = commitSessionOp([=](Dataset& data) {
+            return insertAirline(data, id, iata, name, country);
+        });
+        if (!error.empty())
+            return crow::response(errorPage(error));
 
         return crow::response(successPage("Airline inserted successfully!"));
     });
@@ -1510,20 +5724,14 @@ int main() {
         std::string iata = iata_it->second;
         std::transform(iata.begin(), iata.end(), iata.begin(), ::toupper);
 
-        auto it = session_airlines_by_iata.find(iata);
-        if (it == session_airlines_by_iata.end())
-            return crow::response(errorPage("Airline not found."));
-
-        auto al = it->second;
-
-        auto name_it    = form.find("name");
-        auto country_it = form.find("country");
+        std::string name    = form.count("name") ? form["name"] : "";
+        std::string country = form.count("country") ? form["country"] : "";
 
-        if (name_it != form.end() && !name_it->second.empty())
-            al->name = name_it->second;
-
-        if (country_it != form.end() && !country_it->second.empty())
-            al->country = country_it->second;
+        std::string error = commitSessionOp([=](Dataset& data) {
+            return modifyAirline(data, iata, name, country);
+        });
+        if (!error.empty())
+            return crow::response(errorPage(error));
 
         return crow::response(successPage("Airline modified successfully!"));
     });
@@ -1540,25 +5748,11 @@ int main() {
         std::string iata = iata_it->second;
         std::transform(iata.begin(), iata.end(), iata.begin(), ::toupper);
 
-        auto it = session_airlines_by_iata.find(iata);
-        if (it == session_airlines_by_iata.end())
-            return crow::response(errorPage("Airline not found."));
-
-        int id = it->second->id;
-
-        session_airlines_by_iata.erase(iata);
-        session_airlines_by_id.erase(id);
-
-        session_routes.erase(
-            std::remove_if(
-                session_routes.begin(),
-                session_routes.end(),
-                [&](const std::shared_ptr<Route>& r) {
-                    return r->airline_code == iata;
-                }
-            ),
-            session_routes.end()
-        );
+        std::string error = commitSessionOp([=](Dataset& data) {
+            return deleteAirline(data, iata);
+        });
+        if (!error.empty())
+            return crow::response(errorPage(error));
 
         return crow::response(successPage("Airline and all related routes deleted."));
     });
@@ -1590,21 +5784,11 @@ int main() {
         std::string country = country_it->second;
         std::transform(iata.begin(), iata.end(), iata.begin(), ::toupper);
 
-        if (session_airports_by_id.count(id))
-            return crow::response(errorPage("Airport ID already exists."));
-
-        if (session_airports_by_iata.count(iata))
-            return crow::response(errorPage("Airport IATA already exists."));
-
-        auto ap = std::make_shared<Airport>();
-        ap->id      = id;
-        ap->iata    = iata;
-        ap->name    = name;
-        ap->city    = city;
-        ap->country = country;
-
-        session_airports_by_id[id]     = ap;
-        session_airports_by_iata[iata] = ap;
+        std::string error = commitSessionOp([=](Dataset& data) {
+            return insertAirport(data, id, iata, name, city, country);
+        });
+        if (!error.empty())
+            return crow::response(errorPage(error));
 
         return crow::response(successPage("Airport inserted successfully!"));
     });
@@ -1621,22 +5805,15 @@ int main() {
         std::string iata = iata_it->second;
         std::transform(iata.begin(), iata.end(), iata.begin(), ::toupper);
 
-        auto it = session_airports_by_iata.find(iata);
-        if (it == session_airports_by_iata.end())
-            return crow::response(errorPage("Airport not found."));
-
-        auto ap = it->second;
-
-        auto name_it    = form.find("name");
-        auto city_it    = form.find("city");
-        auto country_it = form.find("country");
+        std::string name    = form.count("name") ? form["name"] : "";
+        std::string city    = form.count("city") ? form["city"] : "";
+        std::string country = form.count("country") ? form["country"] : "";
 
-        if (name_it != form.end() && !name_it->second.empty())
-            ap->name = name_it->second;
-        if (city_it != form.end() && !city_it->second.empty())
-            ap->city = city_it->second;
-        if (country_it != form.end() && !country_it->second.empty())
-            ap->country = country_it->second;
+        std::string error = commitSessionOp([=](Dataset& data) {
+            return modifyAirport(data, iata, name, city, country);
+        });
+        if (!error.empty())
+            return crow::response(errorPage(error));
 
         return crow::response(successPage("Airport modified successfully!"));
     });
@@ -1653,26 +5830,11 @@ int main() {
         std::string iata = iata_it->second;
         std::transform(iata.begin(), iata.end(), iata.begin(), ::toupper);
 
-        auto it = session_airports_by_iata.find(iata);
-        if (it == session_airports_by_iata.end())
-            return crow::response(errorPage("Airport not found."));
-
-        int id = it->second->id;
-
-        session_airports_by_iata.erase(iata);
-        session_airports_by_id.erase(id);
-
-        session_routes.erase(
-            std::remove_if(
-                session_routes.begin(),
-                session_routes.end(),
-                [&](const std::shared_ptr<Route>& r) {
-                    return r->source_airport == iata ||
-                           r->dest_airport   == iata;
-                }
-            ),
-            session_routes.end()
-        );
+        std::string error = commitSessionOp([=](Dataset& data) {
+            return deleteAirport(data, iata);
+        });
+        if (!error.empty())
+            return crow::response(errorPage(error));
 
         return crow::response(successPage("Airport and all related routes deleted."));
     });
@@ -1702,19 +5864,11 @@ int main() {
         std::transform(source.begin(),  source.end(),  source.begin(),  ::toupper);
         std::transform(dest.begin(),    dest.end(),    dest.begin(),    ::toupper);
 
-        if (!session_airlines_by_iata.count(airline))
-            return crow::response(errorPage("Airline not found."));
-
-        if (!session_airports_by_iata.count(source) || !session_airports_by_iata.count(dest))
-            return crow::response(errorPage("Source or destination airport not found."));
-
-        auto r = std::make_shared<Route>();
-        r->airline_code   = airline;
-        r->source_airport = source;
-        r->dest_airport   = dest;
-        r->stops          = 0;
-
-        session_routes.push_back(r);
+        std::string error = commitSessionOp([=](Dataset& data) {
+            return insertRoute(data, airline, source, dest);
+        });
+        if (!error.empty())
+            return crow::response(errorPage(error));
 
         return crow::response(successPage("Route inserted successfully!"));
     });
@@ -1744,25 +5898,860 @@ int main() {
         std::transform(source.begin(),  source.end(),  source.begin(),  ::toupper);
         std::transform(dest.begin(),    dest.end(),    dest.begin(),    ::toupper);
 
-        size_t before = session_routes.size();
+        std::string error = commitSessionOp([=](Dataset& data) {
+            return deleteRoute(data, airline, source, dest);
+        });
+        if (!error.empty())
+            return crow::response(errorPage(error));
+
+        return crow::response(successPage("Route deleted successfully!"));
+    });
+
+    // Bulk import of OpenFlights .dat bodies, optionally gzip-compressed.
+    // Takes a multipart upload with "airports", "airlines" and/or "routes"
+    // parts, or a raw body with ?type=airports|airlines|routes. Bad rows are
+    // reported back; the rest are merged as a single session version.
+    CROW_ROUTE(app, "/manage/import").methods("POST"_method)
+    ([](const crow::request& req) {
+        auto format = req.url_params.get("format");
+        bool as_json = format && std::string(format) == "json";
+
+        auto fail = [&](const std::string& msg) {
+            if (as_json) {
+                crow::json::wvalue err;
+                err["error"] = msg;
+                return crow::response(400, err);
+            }
+            return crow::response(errorPage(msg));
+        };
+
+        std::vector<std::pair<std::string, std::string>> bodies;  // kind, data
+        if (req.get_header_value("Content-Type").find("multipart/form-data") == 0) {
+            crow::multipart::message msg(req);
+            for (const char* kind : {"airports", "airlines", "routes"}) {
+                auto part = msg.get_part_by_name(kind);
+                if (!part.body.empty()) bodies.emplace_back(kind, std::move(part.body));
+            }
+        } else if (auto type = req.url_params.get("type")) {
+            std::string kind = type;
+            if (kind != "airports" && kind != "airlines" && kind != "routes")
+                return fail("Unknown import type '" + kind + "'.");
+            bodies.emplace_back(kind, req.body);
+        }
+
+        if (bodies.empty())
+            return fail("Nothing to import.");
+
+        // Parse outside the lock; only the merge below blocks readers
+        ImportBatch batch;
+        for (auto& [kind, data] : bodies) {
+            if (data.size() >= 2 && data[0] == '\x1f' && data[1] == '\x8b') {
+                data = crow::compression::decompress_string(data);
+                if (data.empty())
+                    return fail("Could not decompress " + kind + " upload.");
+            }
+            if (kind == "airports")      batch.airports = parseAirports(data);
+            else if (kind == "airlines") batch.airlines = parseAirlines(data);
+            else                         batch.routes = parseRoutes(data);
+        }
+
+        // Merged and journaled like any other session operation, so a
+        // reload re-applies the import on top of the new base data
+        auto shared_batch = std::make_shared<const ImportBatch>(std::move(batch));
+        std::vector<ImportReport> reports;
+        uint64_t version;
+        {
+            std::unique_lock<std::shared_mutex> lock(session_mutex);
+            std::string error = mergeImport(session, *shared_batch, reports);
+            if (!error.empty()) return fail(error);
+            session_journal.push_back([shared_batch](Dataset& data) {
+                std::vector<ImportReport> replayed;
+                return mergeImport(data, *shared_batch, replayed);
+            });
+            version = ++session_version;
+        }
 
-        session_routes.erase(
-            std::remove_if(
-                session_routes.begin(),
-                session_routes.end(),
-                [&](const std::shared_ptr<Route>& r) {
-                    return r->airline_code == airline &&
-                           r->source_airport == source &&
-                           r->dest_airport   == dest;
+        if (as_json) {
+            crow::json::wvalue result;
+            result["version"] = version;
+            for (const auto& report : reports) {
+                auto& entry = result[report.kind];
+                entry["accepted"] = report.accepted;
+                entry["rejected_count"] = report.rejected.size();
+                std::vector<crow::json::wvalue> rows;
+                for (const auto& r : report.rejected) {
+                    crow::json::wvalue row;
+                    row["line"] = r.line;
+                    row["reason"] = r.reason;
+                    rows.push_back(std::move(row));
                 }
-            ),
-            session_routes.end()
-        );
+                entry["rejected"] = std::move(rows);
+            }
+            return crow::response(result);
+        }
 
-        if (session_routes.size() == before)
-            return crow::response(errorPage("No matching route found."));
+        // Cap the HTML listing; the JSON form carries every rejected row
+        const size_t max_listed = 100;
+        std::string html = htmlHeader();
+        html += "<h2>📥 Import Results</h2>";
+        for (const auto& report : reports) {
+            html += "<div class='result-box'>";
+            html += "<h3>" + report.kind + "</h3>";
+            html += "<div class='result-item'><strong>Accepted:</strong> " + std::to_string(report.accepted) + "</div>";
+            html += "<div class='result-item'><strong>Rejected:</strong> " + std::to_string(report.rejected.size()) + "</div>";
+            if (!report.rejected.empty()) {
+                html += "<table><thead><tr><th>Line</th><th>Reason</th></tr></thead><tbody>";
+                for (size_t i = 0; i < report.rejected.size() && i < max_listed; i++) {
+                    html += "<tr><td>" + std::to_string(report.rejected[i].line) + "</td>";
+                    html += "<td>" + report.rejected[i].reason + "</td></tr>";
+                }
+                html += "</tbody></table>";
+                if (report.rejected.size() > max_listed)
+                    html += "<p>… and " + std::to_string(report.rejected.size() - max_listed) + " more.</p>";
+            }
+            html += "</div>";
+        }
+        html += "<p><a href='/manage' class='btn'>← Back to Manage Page</a></p>";
+        html += htmlFooter();
+        return crow::response(html);
+    });
 
-        return crow::response(successPage("Route deleted successfully!"));
+    // Reload the .dat files in the background; session changes are re-applied
+    CROW_ROUTE(app, "/admin/reload").methods("POST"_method)
+    ([]() {
+        crow::json::wvalue result;
+        if (!startReload("admin request")) {
+            result["status"] = "already running";
+            return crow::response(409, result);
+        }
+        result["status"] = "started";
+        return crow::response(202, result);
+    });
+
+    CROW_ROUTE(app, "/admin/reload")
+    ([]() {
+        crow::json::wvalue result;
+        result["running"] = reload_running.load();
+        result["version"] = session_version.load();
+        {
+            std::lock_guard<std::mutex> lock(reload_status_mutex);
+            result["last_result"] = reload_status;
+        }
+        return result;
+    });
+
+    // Response cache counters
+    CROW_ROUTE(app, "/admin/cache")
+    ([]() {
+        auto result = response_cache.stats();
+        result["version"] = session_version.load();
+        return result;
+    });
+
+    // JSON fuzzy name search, ?q=...&limit=N (default 10, at most 100)
+    CROW_ROUTE(app, "/api/v1/airports/search")
+    ([](const crow::request& req) {
+        const char* q = req.url_params.get("q");
+        if (!q) return crow::response(400, "missing q parameter");
+        size_t limit = queryLimit(req, 10, 100);
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        crow::json::wvalue result;
+        result["query"] = q;
+        result["results"] = crow::json::wvalue::list();
+        size_t i = 0;
+        for (const auto& match : session.airport_names.search(q, limit)) {
+            const Airport& airport = session.airports.at(match.slot);
+            auto& item = result["results"][i++];
+            item["id"] = airport.id;
+            item["iata"] = airport.iata;
+            item["name"] = airport.name;
+            item["city"] = airport.city;
+            item["country"] = session.dicts.countries.lookup(airport.country);
+            item["score"] = match.score;
+        }
+        return crow::response(result);
+    });
+
+    CROW_ROUTE(app, "/api/v1/airlines/search")
+    ([](const crow::request& req) {
+        const char* q = req.url_params.get("q");
+        if (!q) return crow::response(400, "missing q parameter");
+        size_t limit = queryLimit(req, 10, 100);
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        crow::json::wvalue result;
+        result["query"] = q;
+        result["results"] = crow::json::wvalue::list();
+        size_t i = 0;
+        for (const auto& match : session.airline_names.search(q, limit)) {
+            const Airline& airline = session.airlines.at(match.slot);
+            auto& item = result["results"][i++];
+            item["id"] = airline.id;
+            item["iata"] = airline.iata;
+            item["name"] = airline.name;
+            item["alias"] = airline.alias;
+            item["country"] = session.dicts.countries.lookup(airline.country);
+            item["score"] = match.score;
+        }
+        return crow::response(result);
+    });
+
+    // Single-record lookups by OpenFlights ID or by code. Exactly one of
+    // ?id=, ?iata=, ?icao= (and ?callsign= for airlines) is expected. An
+    // IATA code shared by several airlines returns the active one first.
+    CROW_ROUTE(app, "/api/v1/airports/lookup")
+    ([](const crow::request& req) {
+        const char* id = req.url_params.get("id");
+        const char* iata = req.url_params.get("iata");
+        const char* icao = req.url_params.get("icao");
+        if (!id && !iata && !icao) return jsonError(400, "expected id, iata or icao");
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        const Airport* airport = nullptr;
+        int airport_id;
+        if (id) airport = parseIntField(id, airport_id) ? session.airports.find(airport_id) : nullptr;
+        else if (iata) airport = session.airportByIata(upperCase(iata));
+        else airport = session.airportByIcao(upperCase(icao));
+        if (!airport) return jsonError(404, "airport not found");
+        return crow::response(airportJson(session, *airport));
+    });
+
+    CROW_ROUTE(app, "/api/v1/airlines/lookup")
+    ([](const crow::request& req) {
+        const char* id = req.url_params.get("id");
+        const char* iata = req.url_params.get("iata");
+        const char* icao = req.url_params.get("icao");
+        const char* callsign = req.url_params.get("callsign");
+        if (!id && !iata && !icao && !callsign) return jsonError(400, "expected id, iata, icao or callsign");
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        const Airline* airline = nullptr;
+        int airline_id;
+        if (id) {
+            airline = parseIntField(id, airline_id) ? session.airlines.find(airline_id) : nullptr;
+        } else if (iata) {
+            auto codes = airline_codes.get(session, session_version.load());
+            auto matches = codes->find(upperCase(iata));
+            // ?all=1 lists every airline using the code
+            if (queryFlag(req, "all")) {
+                crow::json::wvalue result = crow::json::wvalue::list();
+                size_t i = 0;
+                for (int32_t slot : matches)
+                    result[i++] = airlineJson(session, session.airlines.at(slot));
+                return crow::response(result);
+            }
+            airline = codes->primary(session, upperCase(iata));
+        } else if (icao) airline = session.airlineByIcao(upperCase(icao));
+        else airline = session.airlineByCallsign(callsign);
+        if (!airline) return jsonError(404, "airline not found");
+        return crow::response(airlineJson(session, *airline));
+    });
+
+    // Batch lookups. The body is a JSON array of OpenFlights IDs (integers)
+    // and codes (strings: IATA, or ICAO by length), at most 1000 of them.
+    // The answer is an array in the same order, null where nothing matched;
+    // all lookups see one snapshot of the session.
+    const size_t max_batch = 1000;
+
+    CROW_ROUTE(app, "/api/v1/airports:batchGet").methods("POST"_method)
+    ([max_batch](const crow::request& req) {
+        auto keys = crow::json::load(req.body);
+        if (!keys || keys.t() != crow::json::type::List) return jsonError(400, "body must be a JSON array");
+        if (keys.size() > max_batch) return jsonError(400, "at most " + std::to_string(max_batch) + " keys per batch");
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        crow::json::wvalue result = crow::json::wvalue::list();
+        for (size_t i = 0; i < keys.size(); i++) {
+            const Airport* airport = nullptr;
+            int id;
+            if (keys[i].t() == crow::json::type::Number) {
+                if (jsonIdKey(keys[i], id)) airport = session.airports.find(id);
+            } else if (keys[i].t() == crow::json::type::String) {
+                std::string code = upperCase(keys[i].s());
+                airport = code.size() == 4 ? session.airportByIcao(code) : session.airportByIata(code);
+            }
+            if (airport) result[i] = airportJson(session, *airport);
+            else result[i] = nullptr;
+        }
+        return crow::response(result);
+    });
+
+    CROW_ROUTE(app, "/api/v1/airlines:batchGet").methods("POST"_method)
+    ([max_batch](const crow::request& req) {
+        auto keys = crow::json::load(req.body);
+        if (!keys || keys.t() != crow::json::type::List) return jsonError(400, "body must be a JSON array");
+        if (keys.size() > max_batch) return jsonError(400, "at most " + std::to_string(max_batch) + " keys per batch");
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        auto codes = airline_codes.get(session, session_version.load());
+        crow::json::wvalue result = crow::json::wvalue::list();
+        for (size_t i = 0; i < keys.size(); i++) {
+            const Airline* airline = nullptr;
+            int id;
+            if (keys[i].t() == crow::json::type::Number) {
+                if (jsonIdKey(keys[i], id)) airline = session.airlines.find(id);
+            } else if (keys[i].t() == crow::json::type::String) {
+                std::string code = upperCase(keys[i].s());
+                if (code.size() == 3) {
+                    airline = session.airlineByIcao(code);
+                } else {
+                    auto matches = codes->find(code);
+                    if (matches.size() > 0) airline = &session.airlines.at(*matches.begin());
+                }
+            }
+            if (airline) result[i] = airlineJson(session, *airline);
+            else result[i] = nullptr;
+        }
+        return crow::response(result);
+    });
+
+    // JSON report pages, ?sort=&limit=N (default 100, at most 1000)&after=
+    CROW_ROUTE(app, "/api/v1/reports/airlines")
+    ([](const crow::request& req) { return jsonReport(req, true); });
+
+    CROW_ROUTE(app, "/api/v1/reports/airports")
+    ([](const crow::request& req) { return jsonReport(req, false); });
+
+    // Route counts grouped by columns, ?group=source_country,dest_country
+    // (at most four of airline, source, dest, source_country, dest_country,
+    // codeshare, stops, equipment), filtered by exact column values such as
+    // ?airline=AA&stops=0, and ?limit=N (default 100, at most 10000).
+    // Equipment is per aircraft type: ?equipment=738 matches every route
+    // flying a 738, and grouping by it counts a route under each of its
+    // types. Groups come largest first.
+    CROW_ROUTE(app, "/api/v1/aggregate")
+    ([](const crow::request& req) {
+        const char* group = req.url_params.get("group");
+        if (!group || !*group) return jsonError(400, "missing group parameter");
+        size_t limit = queryLimit(req, 100, 10000);
+
+        AggregateQuery query;
+        std::stringstream names(group);
+        std::string name;
+        while (std::getline(names, name, ',')) {
+            auto column = RouteColumns::parse(name);
+            if (!column) return jsonError(400, "unknown column '" + name + "'");
+            query.group_by.push_back(*column);
+        }
+        if (query.group_by.size() > 4) return jsonError(400, "at most 4 group columns");
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        auto table = route_columns.get(session, session_version.load());
+        if (table->overflow())
+            return jsonError(503, std::string("too many distinct ") + table->overflow() + " values to aggregate");
+        bool matches_nothing = false;
+        for (int c = 0; c < RouteColumns::COLUMN_COUNT; c++) {
+            auto column = static_cast<RouteColumns::Column>(c);
+            const char* value = req.url_params.get(RouteColumns::NAMES[c]);
+            if (!value) continue;
+            uint16_t code;
+            if (table->dictionary(column).find(value, code)) query.filters.push_back({column, code});
+            else matches_nothing = true;
+        }
+
+        std::vector<AggregateGroup> groups;
+        uint64_t total_routes = 0;
+        if (!matches_nothing) groups = aggregateRoutes(*table, query, total_routes);
+        size_t n = std::min(limit, groups.size());
+        std::partial_sort(groups.begin(), groups.begin() + n, groups.end(), [](const auto& a, const auto& b) {
+            return a.routes != b.routes ? a.routes > b.routes : a.key < b.key;
+        });
+
+        crow::json::wvalue result;
+        result["group_by"] = crow::json::wvalue::list();
+        for (size_t j = 0; j < query.group_by.size(); j++)
+            result["group_by"][j] = RouteColumns::NAMES[query.group_by[j]];
+        result["total_routes"] = total_routes;
+        result["total_groups"] = groups.size();
+        result["groups"] = crow::json::wvalue::list();
+        for (size_t i = 0; i < n; i++) {
+            auto& item = result["groups"][i];
+            size_t k = query.group_by.size();
+            for (size_t j = 0; j < k; j++) {
+                auto column = query.group_by[j];
+                uint16_t code = (uint16_t)(groups[i].key >> (16 * (k - 1 - j)));
+                item[RouteColumns::NAMES[column]] = table->dictionary(column).lookup(code);
+            }
+            item["routes"] = groups[i].routes;
+            item["codeshares"] = groups[i].codeshares;
+        }
+        return crow::response(result);
+    });
+
+    // Routes matching every given field, ?airline=AA&source_country=Germany
+    // &equipment=738&codeshare=N&stops=0&limit=N (default 100, at most
+    // 10000). A repeated field matches any of its values.
+    CROW_ROUTE(app, "/api/v1/routes/query")
+    ([](const crow::request& req) {
+        size_t limit = queryLimit(req, 100, 10000);
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        auto index = route_bitmaps.get(session, session_version.load());
+        std::vector<RouteBitmap> terms;
+        for (int f = 0; f < RouteBitmapIndex::FIELD_COUNT; f++) {
+            auto values = req.url_params.get_list(RouteBitmapIndex::NAMES[f], false);
+            if (values.empty()) continue;
+            std::vector<std::string> wanted(values.begin(), values.end());
+            terms.push_back(index->any(static_cast<RouteBitmapIndex::Field>(f), wanted));
+        }
+        if (terms.empty()) return jsonError(400, "at least one filter is required");
+
+        // Intersect smallest first so intermediate sets stay small
+        std::sort(terms.begin(), terms.end(), [](const auto& a, const auto& b) {
+            return a.cardinality() < b.cardinality();
+        });
+        RouteBitmap rows = terms[0];
+        for (size_t i = 1; i < terms.size(); i++) rows = RouteBitmap::intersect(rows, terms[i]);
+
+        crow::json::wvalue result;
+        result["total"] = rows.cardinality();
+        result["routes"] = crow::json::wvalue::list();
+        size_t n = 0;
+        rows.forEach([&](uint32_t row) {
+            if (n == limit) return false;
+            result["routes"][n++] = routeJson(session.routes[row]);
+            return true;
+        });
+        return crow::response(result);
+    });
+
+    // Routes flown with an aircraft type, ?code=738&limit=N (default 100,
+    // at most 10000)
+    CROW_ROUTE(app, "/api/v1/equipment/routes")
+    ([](const crow::request& req) {
+        const char* code = req.url_params.get("code");
+        if (!code || !*code) return jsonError(400, "missing code parameter");
+        size_t limit = queryLimit(req, 100, 10000);
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        auto index = equipment_index.get(session, session_version.load());
+        if (index->full()) return jsonError(503, "too many distinct equipment values to index");
+        auto rows = index->rowsOf(upperCase(code));
+        crow::json::wvalue result;
+        result["code"] = upperCase(code);
+        result["total"] = rows.size();
+        result["routes"] = crow::json::wvalue::list();
+        size_t n = 0;
+        for (uint32_t row : rows) {
+            if (n == limit) break;
+            result["routes"][n++] = routeJson(session.routes[row]);
+        }
+        return crow::response(result);
+    });
+
+    // Aircraft types by route count for ?airline=AA, or across all routes
+    CROW_ROUTE(app, "/api/v1/equipment/mix")
+    ([](const crow::request& req) {
+        const char* airline = req.url_params.get("airline");
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        auto index = equipment_index.get(session, session_version.load());
+        if (index->full()) return jsonError(503, "too many distinct equipment values to index");
+        const std::vector<EquipmentIndex::Mix>* mix = &index->overall();
+        crow::json::wvalue result;
+        if (airline) {
+            result["airline"] = upperCase(airline);
+            mix = index->mixOf(upperCase(airline));
+            if (!mix) return jsonError(404, "no routes for airline");
+        }
+        result["equipment"] = crow::json::wvalue::list();
+        for (size_t i = 0; i < mix->size(); i++) {
+            auto& item = result["equipment"][i];
+            item["code"] = index->name((*mix)[i].code);
+            item["routes"] = (*mix)[i].routes;
+        }
+        return crow::response(result);
+    });
+
+    // Country-to-country route and distinct airline counts over every
+    // country with routes, ?format=json (default) or csv; the CSV holds
+    // one ?metric=routes|airlines. Rendered once per data version.
+    CROW_ROUTE(app, "/api/v1/countries/matrix")
+    ([](const crow::request& req) {
+        const char* format_param = req.url_params.get("format");
+        const char* metric_param = req.url_params.get("metric");
+        std::string format = format_param ? format_param : "json";
+        std::string metric = metric_param ? metric_param : "routes";
+        if (format != "json" && format != "csv") return jsonError(400, "format must be json or csv");
+        if (metric != "routes" && metric != "airlines") return jsonError(400, "metric must be routes or airlines");
+        if (format == "json") metric = "both";
+
+        crow::response res(cachedPage("countries/matrix|" + format + "|" + metric, [&] {
+            std::shared_lock<std::shared_mutex> lock(session_mutex);
+            const CountryMatrix& matrix = session.country_matrix;
+
+            // Countries with a route either way; code 0 is the unknown airport
+            std::vector<uint16_t> codes;
+            for (size_t c = 1; c < matrix.size(); c++) {
+                bool used = false;
+                for (size_t o = 0; o < matrix.size() && !used; o++)
+                    used = matrix.routes(c, o) || matrix.routes(o, c);
+                if (used) codes.push_back((uint16_t)c);
+            }
+            auto name = [&](uint16_t code) { return session.dicts.countries.lookup(code); };
+
+            std::string body;
+            if (format == "csv") {
+                auto field = [](const std::string& text) {
+                    if (text.find_first_of(",\"\n") == std::string::npos) return text;
+                    std::string quoted = "\"";
+                    for (char c : text) quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+                    return quoted + "\"";
+                };
+                body = "source\\dest";
+                for (uint16_t d : codes) body += "," + field(name(d));
+                body += "\n";
+                for (uint16_t s : codes) {
+                    body += field(name(s));
+                    for (uint16_t d : codes)
+                        body += "," + std::to_string(metric == "routes" ? matrix.routes(s, d) : matrix.airlines(s, d));
+                    body += "\n";
+                }
+                return body;
+            }
+
+            auto rows = [&](auto cell) {
+                std::string out = "[";
+                for (size_t i = 0; i < codes.size(); i++) {
+                    out += i ? ",[" : "[";
+                    for (size_t j = 0; j < codes.size(); j++) {
+                        if (j) out += ",";
+                        out += std::to_string(cell(codes[i], codes[j]));
+                    }
+                    out += "]";
+                }
+                return out + "]";
+            };
+            body = "{\"countries\":[";
+            for (size_t i = 0; i < codes.size(); i++) {
+                body += i ? ",\"" : "\"";
+                body += crow::json::escape(name(codes[i])) + "\"";
+            }
+            body += "],\"routes\":" + rows([&](uint16_t s, uint16_t d) { return matrix.routes(s, d); });
+            body += ",\"airlines\":" + rows([&](uint16_t s, uint16_t d) { return matrix.airlines(s, d); });
+            return body + "}";
+        }));
+        res.set_header("Content-Type", format == "csv" ? "text/csv" : "application/json");
+        return res;
+    });
+
+    // One cell of the country matrix, ?from=Germany&to=France
+    CROW_ROUTE(app, "/api/v1/countries/pair")
+    ([](const crow::request& req) {
+        const char* from = req.url_params.get("from");
+        const char* to = req.url_params.get("to");
+        if (!from || !to) return jsonError(400, "missing from or to parameter");
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        uint16_t source = 0, dest = 0;
+        if (!session.dicts.countries.find(from, source) || !source) return jsonError(404, "unknown country");
+        if (!session.dicts.countries.find(to, dest) || !dest) return jsonError(404, "unknown country");
+        crow::json::wvalue result;
+        result["from"] = from;
+        result["to"] = to;
+        result["routes"] = session.country_matrix.routes(source, dest);
+        result["airlines"] = session.country_matrix.airlines(source, dest);
+        return crow::response(result);
+    });
+
+    // Top hubs by ?metric=routes|destinations|airlines (default
+    // destinations), optionally within ?country=, ?limit=K (default 10, at
+    // most 1000). Read off incrementally maintained ranks in O(K).
+    CROW_ROUTE(app, "/api/v1/hubs")
+    ([](const crow::request& req) {
+        const char* metric_param = req.url_params.get("metric");
+        const char* country = req.url_params.get("country");
+        size_t limit = queryLimit(req, 10, 1000);
+        std::string metric_name = metric_param ? metric_param : "destinations";
+        auto names = std::begin(HubCounters::NAMES);
+        auto found = std::find(names, std::end(HubCounters::NAMES), metric_name);
+        if (found == std::end(HubCounters::NAMES)) return jsonError(400, "metric must be routes, destinations or airlines");
+        auto metric = static_cast<HubCounters::Metric>(found - names);
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        std::optional<uint16_t> country_code;
+        if (country) {
+            uint16_t code;
+            if (!session.dicts.countries.find(country, code) || !code) return jsonError(404, "unknown country");
+            country_code = code;
+        }
+
+        crow::json::wvalue result;
+        result["metric"] = metric_name;
+        if (country) result["country"] = country;
+        result["hubs"] = crow::json::wvalue::list();
+        size_t i = 0;
+        session.hubs.top(metric, country_code, limit, [&](const HubCounters::Hub& hub) {
+            auto& item = result["hubs"][i++];
+            item["iata"] = hub.iata;
+            const Airport* airport = session.airportByIata(hub.iata);
+            item["name"] = airport ? airport->name : "";
+            item["country"] = session.dicts.countries.lookup(hub.country);
+            item["routes_out"] = hub.routes_out;
+            item["routes_in"] = hub.routes_in;
+            item["destinations"] = hub.score[HubCounters::DESTINATIONS];
+            item["airlines"] = hub.score[HubCounters::AIRLINES];
+        });
+        return crow::response(result);
+    });
+
+    // Airports ranked by ?metric=betweenness|closeness (default
+    // betweenness), ?limit=N (default 20, at most 1000). Computed by a
+    // background job per data version: until the current version is done
+    // this starts the job if needed and answers 202 with its progress.
+    CROW_ROUTE(app, "/api/v1/centrality")
+    ([](const crow::request& req) {
+        const char* metric_param = req.url_params.get("metric");
+        std::string metric = metric_param ? metric_param : "betweenness";
+        if (metric != "betweenness" && metric != "closeness")
+            return jsonError(400, "metric must be betweenness or closeness");
+        size_t limit = queryLimit(req, 20, 1000);
+
+        std::shared_ptr<const Centrality> result;
+        {
+            std::lock_guard<std::mutex> lock(centrality_mutex);
+            result = centrality_result;
+        }
+        if (!result || result->version != session_version.load()) {
+            startCentrality();
+            return crow::response(202, centralityStatus());
+        }
+
+        const auto& scores = metric == "betweenness" ? result->betweenness : result->closeness;
+        std::vector<uint32_t> ranked(scores.size());
+        for (uint32_t v = 0; v < ranked.size(); v++) ranked[v] = v;
+        size_t n = std::min(limit, ranked.size());
+        std::partial_sort(ranked.begin(), ranked.begin() + n, ranked.end(), [&](uint32_t a, uint32_t b) {
+            return scores[a] != scores[b] ? scores[a] > scores[b] : a < b;
+        });
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        crow::json::wvalue body;
+        body["metric"] = metric;
+        body["version"] = result->version;
+        body["elapsed_ms"] = result->elapsed_ms;
+        body["airports"] = crow::json::wvalue::list();
+        for (size_t i = 0; i < n; i++) {
+            uint32_t v = ranked[i];
+            auto& item = body["airports"][i];
+            item["iata"] = result->graph->codes[v];
+            const Airport* airport = session.airportByIata(result->graph->codes[v]);
+            item["name"] = airport ? airport->name : "";
+            item["betweenness"] = result->betweenness[v];
+            item["closeness"] = result->closeness[v];
+        }
+        return crow::response(body);
+    });
+
+    // Recompute centrality now, whatever the cached version
+    CROW_ROUTE(app, "/api/v1/centrality/recompute").methods("POST"_method)
+    ([]() {
+        if (!startCentrality()) return crow::response(409, centralityStatus());
+        return crow::response(202, centralityStatus());
+    });
+
+    CROW_ROUTE(app, "/api/v1/centrality/status")
+    ([]() { return centralityStatus(); });
+
+    // Whether two airports are linked by routes in either direction,
+    // ?from=&to=. Served by the incremental union-find, rebuilt here first
+    // if routes were deleted since the last read.
+    CROW_ROUTE(app, "/api/v1/connectivity/connected")
+    ([](const crow::request& req) {
+        const char* from = req.url_params.get("from");
+        const char* to = req.url_params.get("to");
+        if (!from || !to) return jsonError(400, "missing from or to parameter");
+        std::string source = upperCase(from), dest = upperCase(to);
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        crow::json::wvalue result;
+        result["from"] = source;
+        result["to"] = dest;
+        const WeakComponents& components = session.weak_components;
+        components.refresh(session.routes);
+        auto a = components.find(source), b = components.find(dest);
+        if (!a || !b) return jsonError(404, "airport has no routes");
+        result["connected"] = *a == *b;
+        result["component_size"] = components.sizeOf(*a);
+        return crow::response(result);
+    });
+
+    // Whether passengers can get from one airport to another at all,
+    // following route directions, ?from=&to=
+    CROW_ROUTE(app, "/api/v1/connectivity/reachable")
+    ([](const crow::request& req) {
+        const char* from = req.url_params.get("from");
+        const char* to = req.url_params.get("to");
+        if (!from || !to) return jsonError(400, "missing from or to parameter");
+        std::string source = upperCase(from), dest = upperCase(to);
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        auto index = connectivity.get(session, session_version.load());
+        auto a = index->vertexOf(source), b = index->vertexOf(dest);
+        if (!a || !b) return jsonError(404, "airport has no routes");
+        crow::json::wvalue result;
+        result["from"] = source;
+        result["to"] = dest;
+        result["reachable"] = index->reaches(*a, *b);
+        result["same_strong_component"] = index->strongComponent(*a) == index->strongComponent(*b);
+        return crow::response(result);
+    });
+
+    // Component sizes of one airport and how many airports it reaches, ?iata=
+    CROW_ROUTE(app, "/api/v1/connectivity/component")
+    ([](const crow::request& req) {
+        const char* iata = req.url_params.get("iata");
+        if (!iata) return jsonError(400, "missing iata parameter");
+        std::string code = upperCase(iata);
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        auto index = connectivity.get(session, session_version.load());
+        auto v = index->vertexOf(code);
+        if (!v) return jsonError(404, "airport has no routes");
+        crow::json::wvalue result;
+        result["iata"] = code;
+        result["weak_component_size"] = index->weakSize(*v);
+        result["strong_component_size"] = index->strongSize(*v);
+        result["reachable_airports"] = index->reachableFrom(*v);
+        return crow::response(result);
+    });
+
+    // Component counts and sizes over the whole route network
+    CROW_ROUTE(app, "/api/v1/connectivity")
+    ([]() {
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        auto index = connectivity.get(session, session_version.load());
+        crow::json::wvalue result;
+        result["weak_components"] = index->weakComponents();
+        result["strong_components"] = index->strongComponents();
+        result["largest_weak_component"] = index->largestWeak();
+        result["largest_strong_component"] = index->largestStrong();
+        return crow::response(result);
+    });
+
+    // Minimum number of flights from one airport to another, ?from=&to=;
+    // hops is null when there is no path
+    CROW_ROUTE(app, "/api/v1/hops")
+    ([](const crow::request& req) {
+        const char* from = req.url_params.get("from");
+        const char* to = req.url_params.get("to");
+        if (!from || !to) return jsonError(400, "missing from or to parameter");
+        std::string source = upperCase(from), dest = upperCase(to);
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        auto matrix = hop_matrix.get(session, session_version.load());
+        auto a = matrix->vertexOf(source), b = matrix->vertexOf(dest);
+        if (!a || !b) return jsonError(404, "airport has no routes");
+        int hops = matrix->hops(*a, *b);
+        if (hops == HopMatrix::UNREACHABLE) hops = -1;
+        else if (hops == HopMatrix::BEYOND) hops = matrix->farHops(*a, *b);
+
+        crow::json::wvalue result;
+        result["from"] = source;
+        result["to"] = dest;
+        if (hops < 0) result["hops"] = nullptr;
+        else result["hops"] = hops;
+        return crow::response(result);
+    });
+
+    // Shortest distance in miles over any sequence of routes, ?from=&to=;
+    // distance is null when no sequence of routes connects them. Answers
+    // from the latest built index, whose version says which data it
+    // reflects; 202 until the first build finishes.
+    CROW_ROUTE(app, "/api/v1/distance")
+    ([](const crow::request& req) {
+        const char* from = req.url_params.get("from");
+        const char* to = req.url_params.get("to");
+        if (!from || !to) return jsonError(400, "missing from or to parameter");
+        std::string source = upperCase(from), dest = upperCase(to);
+
+        auto index = currentDistanceIndex();
+        if (!index) return crow::response(202, distanceIndexStatus());
+        auto a = index->vertexOf(source), b = index->vertexOf(dest);
+        if (!a || !b) return jsonError(404, "airport has no routes");
+        auto distance = index->distance(*a, *b);
+
+        crow::json::wvalue result;
+        result["from"] = source;
+        result["to"] = dest;
+        if (distance) result["distance"] = *distance;
+        else result["distance"] = nullptr;
+        result["version"] = index->version;
+        result["current"] = index->version == session_version.load();
+        return crow::response(result);
+    });
+
+    // Does a route exist? ?src=&dst= and optionally ?airline= (any airline
+    // when omitted). Answered from the route index without touching the
+    // route list; most misses stop at its Bloom filter.
+    CROW_ROUTE(app, "/api/v1/route/exists")
+    ([](const crow::request& req) {
+        const char* src = req.url_params.get("src");
+        const char* dst = req.url_params.get("dst");
+        const char* airline = req.url_params.get("airline");
+        if (!src || !dst) return jsonError(400, "expected src and dst");
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        uint32_t count = session.route_index.count(airline ? upperCase(airline) : "",
+                                                   upperCase(src), upperCase(dst));
+        crow::json::wvalue result;
+        result["exists"] = count > 0;
+        result["count"] = count;
+        return crow::response(result);
+    });
+
+    // Type-ahead suggestions, ?q=prefix&type=airports|airlines|all&limit=N
+    // (default 8, at most 50), busiest first. Missing codes come back empty.
+    CROW_ROUTE(app, "/api/v1/autocomplete")
+    ([](const crow::request& req) {
+        const char* q = req.url_params.get("q");
+        if (!q || !*q) return crow::response(400, "missing q parameter");
+        std::string type = req.url_params.get("type") ? req.url_params.get("type") : "all";
+        if (type != "airports" && type != "airlines" && type != "all")
+            return crow::response(400, "type must be airports, airlines or all");
+        size_t limit = queryLimit(req, 8, 50);
+
+        std::shared_lock<std::shared_mutex> lock(session_mutex);
+        auto index = autocomplete_index.get(session, session_version.load());
+
+        struct Suggestion { const PrefixIndex::Entry* entry; bool airport; };
+        std::vector<Suggestion> suggestions;
+        if (type != "airlines")
+            for (auto* e : index->airports.complete(q, limit)) suggestions.push_back({e, true});
+        if (type != "airports")
+            for (auto* e : index->airlines.complete(q, limit)) suggestions.push_back({e, false});
+        std::stable_sort(suggestions.begin(), suggestions.end(),
+                         [](const Suggestion& a, const Suggestion& b) { return a.entry->routes > b.entry->routes; });
+        if (suggestions.size() > limit) suggestions.resize(limit);
+
+        crow::json::wvalue result;
+        result["query"] = q;
+        result["results"] = crow::json::wvalue::list();
+        for (size_t i = 0; i < suggestions.size(); i++) {
+            const auto& s = suggestions[i];
+            auto& item = result["results"][i];
+            item["routes"] = s.entry->routes;
+            if (s.airport) {
+                const Airport& airport = session.airports.at(s.entry->slot);
+                item["type"] = "airport";
+                item["id"] = airport.id;
+                item["iata"] = codeKey(airport.iata);
+                item["icao"] = codeKey(airport.icao);
+                item["name"] = airport.name;
+                item["city"] = airport.city;
+                item["country"] = session.dicts.countries.lookup(airport.country);
+            } else {
+                const Airline& airline = session.airlines.at(s.entry->slot);
+                item["type"] = "airline";
+                item["id"] = airline.id;
+                item["iata"] = codeKey(airline.iata);
+                item["icao"] = codeKey(airline.icao);
+                item["name"] = airline.name;
+                item["country"] = session.dicts.countries.lookup(airline.country);
+            }
+        }
+        return crow::response(result);
     });
 
     std::cout << "OpenFlights Web Service Starting...\n";
@@ -1775,6 +6764,15 @@ int main() {
         }
     }
 
+    // Watch the data files unless RELOAD_POLL_SECONDS is 0
+    int poll_seconds = 2;
+    if (const char* env_p = std::getenv("RELOAD_POLL_SECONDS")) {
+        poll_seconds = safe_stoi(env_p, poll_seconds);
+    }
+    if (poll_seconds > 0) {
+        std::thread(watchDataFiles, poll_seconds).detach();
+    }
+
     std::cout << "Server running on port " << port << "\n";
     std::cout << "Press Ctrl+C to stop\n";
     